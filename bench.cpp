@@ -0,0 +1,182 @@
+// Microbenchmarks for the grid and ocean kernels.
+// Every kernel is run over a range of grid sizes and densities with fixed seeds
+// and the timings are written out as JSON so runs can be compared over time.
+//
+// Usage: bench [--out bench.json] [--max_size 4096] [--min_time 0.2] [--filter name]
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <cstdlib>
+#include "ocean.hpp"
+
+struct bench_result {
+  std::string kernel;
+  int rows , cols;
+  double density;
+  long long calls; // Number of kernel calls timed
+  long long items; // Cells (or moves, births) processed per call
+  double seconds;  // Best time of a single repetition
+};
+
+// Benchmark parameters, shared by every kernel
+struct bench_config {
+  std::string out = "bench.json";
+  int max_size = 4096;
+  double min_time = 0.2; // seconds spent timing each case
+  std::string filter = "";
+  unsigned seed = 322;
+};
+
+double time_kernel( const bench_config &cfg , long long &calls , const std::function<void()> &setup , const std::function<void()> &kernel ) {
+  // Runs kernel until min_time has passed (at least 3 times) and returns the fastest call
+  using clock = std::chrono::steady_clock;
+  double best = 1e300 , total = 0.0;
+  calls = 0;
+  while ( calls < 3 || total < cfg.min_time ) {
+    if ( setup ) { setup(); }
+    auto start = clock::now();
+    kernel();
+    double elapsed = std::chrono::duration<double>(clock::now()-start).count();
+    best = std::min(best,elapsed);
+    total += elapsed;
+    calls++;
+    if ( elapsed > 2*cfg.min_time ) { break; } // Big cases only get one call
+  } // End timing loop
+  return best;
+} // End timing a kernel
+
+ocean make_ocean( int m , int n , double density , unsigned seed ) {
+  // Fills density of the cells with a 1:2:2 mix of ships, turtles and garbage
+  engine().seed(seed);
+  long long occupied = density*m*n;
+  int ships = occupied/5;
+  int turtles = 2*occupied/5;
+  int garbage = occupied-ships-turtles;
+  ocean o(m,n,100);
+  o.initiate_grid(ships,turtles,garbage);
+  return o;
+} // End making a benchmark ocean
+
+std::vector<pair<int,int>> sample_points( int m , int n , int count , unsigned seed ) {
+  std::default_random_engine gen(seed);
+  std::uniform_int_distribution<int> row(0,m-1) , col(0,n-1);
+  std::vector<pair<int,int>> points(count);
+  for ( auto &p : points ) { p = { row(gen) , col(gen) }; }
+  return points;
+} // End sampling random points in the grid
+
+void write_json( const std::string &path , const std::vector<bench_result> &results ) {
+  std::ofstream file(path);
+  if (!file) throw std::runtime_error("Could not open "+path+" for writing.");
+  file << "{\n  \"benchmarks\": [\n";
+  for ( std::size_t k=0 ; k<results.size() ; k++ ) {
+    auto &r = results[k];
+    file << "    { \"kernel\": \"" << r.kernel << "\", \"rows\": " << r.rows << ", \"cols\": " << r.cols
+	 << ", \"density\": " << r.density << ", \"calls\": " << r.calls << ", \"items\": " << r.items
+	 << ", \"seconds\": " << r.seconds << ", \"ns_per_item\": " << 1e9*r.seconds/std::max(1LL,r.items) << " }"
+	 << ( k+1<results.size() ? ",\n" : "\n" );
+  } // End loop over results
+  file << "  ]\n}\n";
+} // End writing the results as json
+
+int main( int argc , char **argv ) {
+  bench_config cfg;
+  for ( int a=1 ; a+1<argc ; a+=2 ) {
+    std::string flag = argv[a];
+    if      ( flag == "--out" )      { cfg.out = argv[a+1]; }
+    else if ( flag == "--max_size" ) { cfg.max_size = std::atoi(argv[a+1]); }
+    else if ( flag == "--min_time" ) { cfg.min_time = std::atof(argv[a+1]); }
+    else if ( flag == "--filter" )   { cfg.filter = argv[a+1]; }
+    else { std::cerr << "Unknown option " << flag << '\n'; return 1; }
+  } // End reading the options
+
+  std::vector<int> sizes = { 20 , 64 , 256 , 1024 , 4096 };
+  std::vector<double> densities = { 0.01 , 0.1 , 0.3 };
+  std::vector<bench_result> results;
+  const int n_points = 4096; // Random positions used by the point kernels
+
+  auto run = [&]( const std::string &kernel , int m , int n , double density , long long items ,
+		  const std::function<void()> &setup , const std::function<void()> &body ) {
+    if ( !cfg.filter.empty() && kernel.find(cfg.filter) == std::string::npos ) { return; }
+    bench_result r{ kernel , m , n , density , 0 , items , 0.0 };
+    r.seconds = time_kernel(cfg,r.calls,setup,body);
+    std::cout << kernel << " " << m << "x" << n << " density " << density << ": "
+	      << 1e9*r.seconds/std::max(1LL,items) << " ns/item\n";
+    results.push_back(r);
+  };
+
+  for ( int size : sizes ) {
+    if ( size > cfg.max_size ) { continue; }
+    for ( double density : densities ) {
+      long long cells = (long long)size*size;
+      ocean base = make_ocean(size,size,density,cfg.seed);
+      grid_2d grid = base.get_grid();
+      grid_2d scratch = grid;
+      auto points = sample_points(size,size,n_points,cfg.seed);
+      volatile long long sink = 0; // Keeps the compiler from removing kernels
+
+      run("get_num_cell_type",size,size,density,cells,{},[&]{
+	sink = sink + grid.get_num_cell_type(cell_type::turtle);
+      });
+
+      run("neighbors",size,size,density,n_points,{},[&]{
+	for ( auto [i,j] : points ) { sink = sink + grid.neighbors(i,j).size(); }
+      });
+
+      run("count_around",size,size,density,n_points,{},[&]{
+	for ( auto [i,j] : points ) { sink = sink + grid.count_around(i,j,cell_type::garbage); }
+      });
+
+      run("random_cell",size,size,density,n_points,[&]{ engine().seed(cfg.seed); },[&]{
+	for ( auto [i,j] : points ) { sink = sink + grid.random_cell(i,j).first; }
+      });
+
+      run("get_valid_random_move",size,size,density,n_points,[&]{ engine().seed(cfg.seed); },[&]{
+	for ( auto [i,j] : points ) { sink = sink + grid.get_valid_random_move(i,j,cell_type::turtle,grid).first; }
+      });
+
+      // One sweep of every cell into a grid holding just the garbage, as
+      // step_forward sets it up (in row order here rather than shuffled)
+      run("random_motion",size,size,density,cells,[&]{
+	engine().seed(cfg.seed);
+	scratch.copy_type(grid,cell_type::garbage);
+      },[&]{
+	for ( int i=0 ; i<size ; i++ ) {
+	  for ( int j=0 ; j<size ; j++ ) { grid.random_motion(i,j,scratch,false,false); }
+	} // End loop over the grid
+      });
+
+      run("permuted_indicies",size,size,density,cells,[&]{ engine().seed(cfg.seed); },[&]{
+	sink = sink + base.permuted_indicies().size();
+      });
+
+      ocean stepper = base;
+      run("step_forward",size,size,density,cells,[&]{
+	engine().seed(cfg.seed);
+	stepper = base;
+      },[&]{
+	stepper.step_forward(false,false);
+      });
+
+      // Rate picked so every call places 16 new turtles
+      int turtles = base.count_last_grid_items(cell_type::turtle);
+      double rate = turtles>0 ? 1.0+16.0/turtles : 1.0;
+      run("reproduce_turtles",size,size,density,16,[&]{
+	engine().seed(cfg.seed);
+	stepper = base;
+      },[&]{
+	stepper.reproduce_turtles(rate);
+      });
+    } // End loop over densities
+  } // End loop over sizes
+
+  write_json(cfg.out,results);
+  std::cout << "Wrote " << results.size() << " results to " << cfg.out << '\n';
+  return 0;
+} // End of int main
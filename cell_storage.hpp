@@ -0,0 +1,172 @@
+#pragma once // Guard multiple instances
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+template <class cell_t>
+class cell_storage {
+  // Cells of an m x n grid kept in 64 x 64 tiles instead of one big vector.
+  // Tiles are carved out of slabs of up to 512 tiles (2 MiB of one byte cells,
+  // a single huge page), so a multi-gigacell ocean is many moderate
+  // allocations rather than one giant one, and neighbors in both directions
+  // are usually in the same tile. Indices are 64 bit throughout.
+  // The storage is sparse: a tile that is all open water (a cell of type 0)
+  // has no memory at all until something else is written into it, and
+  // release() hands an empty tile back to a free list for the next one that
+  // is needed. Memory then follows the occupied part of the ocean.
+public:
+  static constexpr int tile_shift = 6;
+  static constexpr int tile_side = 1<<tile_shift; // 64
+  static constexpr int tile_cells = tile_side*tile_side;
+  static constexpr int slab_tiles = 512;
+
+  static inline bool huge_pages = false; // Back big slabs with transparent huge pages (Linux)
+private:
+  struct slab_deleter {
+    std::size_t bytes{0};
+    bool mapped{false};
+    void operator()( cell_t *p ) const {
+#if defined(__linux__)
+      if ( mapped ) { munmap(p,bytes); return; }
+#endif
+      std::free(p);
+    }
+  };
+
+  static inline const cell_t water_tile[tile_cells] = {}; // What every missing tile reads as
+
+  std::int64_t m{0} , n{0};
+  std::int64_t tiles_m{0} , tiles_n{0};
+  std::vector<cell_t*> tiles; // Tile table, row major over tiles, nullptr for all water
+  std::vector<cell_t*> free_tiles; // Released tiles ready to be used again
+  std::vector<std::unique_ptr<cell_t,slab_deleter>> slabs;
+  std::size_t slab_used{0}; // Tiles handed out from the newest slab
+  std::size_t slab_size{0}; // Tiles in the newest slab
+  std::int64_t n_allocated{0}; // Tiles in use
+
+  static std::unique_ptr<cell_t,slab_deleter> allocate_slab( std::size_t n_tiles ) {
+    std::size_t bytes = n_tiles*tile_cells*sizeof(cell_t);
+#if defined(__linux__)
+    if ( huge_pages && bytes >= (std::size_t(2)<<20) ) {
+      void *p = mmap(nullptr,bytes,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+      if ( p != MAP_FAILED ) {
+	madvise(p,bytes,MADV_HUGEPAGE);
+	return std::unique_ptr<cell_t,slab_deleter>( (cell_t*)p , slab_deleter{bytes,true} );
+      } // Fall back to the normal allocator if the mapping failed
+    }
+#endif
+    void *p = std::calloc(bytes,1);
+    if ( !p ) { throw std::bad_alloc(); }
+    return std::unique_ptr<cell_t,slab_deleter>( (cell_t*)p , slab_deleter{bytes,false} );
+  } // End allocating a slab
+
+  cell_t* new_tile() {
+    // An all water tile, reused if one was released, otherwise the next one of the newest slab
+    n_allocated++;
+    if ( !free_tiles.empty() ) {
+      cell_t *t = free_tiles.back();
+      free_tiles.pop_back();
+      std::fill(t,t+tile_cells,cell_t());
+      return t;
+    }
+    if ( slab_used == slab_size ) {
+      slab_size = std::min<std::size_t>(slab_tiles,tiles.size());
+      slabs.push_back( allocate_slab(slab_size) );
+      slab_used = 0;
+    } // Newest slab is used up
+    return slabs.back().get() + (slab_used++)*tile_cells;
+  } // End getting a new tile
+
+  void allocate( std::int64_t rows , std::int64_t cols ) {
+    m = rows;
+    n = cols;
+    tiles_m = (m+tile_side-1)>>tile_shift;
+    tiles_n = (n+tile_side-1)>>tile_shift;
+    tiles.assign(tiles_m*tiles_n,nullptr);
+    free_tiles.clear();
+    slabs.clear();
+    slab_used = slab_size = 0;
+    n_allocated = 0;
+  } // End setting up an empty tile table
+
+  cell_t* writable_tile( std::size_t t ) {
+    if ( !tiles[t] ) { tiles[t] = new_tile(); }
+    return tiles[t];
+  } // End getting a tile that can be written to
+public:
+  cell_storage() = default;
+  cell_storage( std::int64_t rows , std::int64_t cols ) { allocate(rows,cols); }
+
+  cell_storage( const cell_storage &other ) { *this = other; }
+
+  cell_storage& operator = ( const cell_storage &other ) {
+    // Reuses our tiles when the sizes match, which is the usual case
+    if ( this == &other ) { return *this; }
+    if ( m != other.m || n != other.n ) { allocate(other.m,other.n); }
+    for (std::size_t t=0 ; t<tiles.size() ; t++) {
+      if ( !other.tiles[t] ) { release(t/tiles_n,t%tiles_n); continue; }
+      std::memcpy(writable_tile(t),other.tiles[t],tile_cells*sizeof(cell_t));
+    } // End copying tiles
+    return *this;
+  } // End copying storage
+
+  cell_storage( cell_storage && ) = default;
+  cell_storage& operator = ( cell_storage && ) = default;
+
+  std::int64_t rows() const { return m; }
+  std::int64_t cols() const { return n; }
+  std::int64_t size() const { return m*n; }
+  std::int64_t tile_rows() const { return tiles_m; }
+  std::int64_t tile_cols() const { return tiles_n; }
+  std::int64_t allocated_tiles() const { return n_allocated; }
+
+  const cell_t& get( std::int64_t i , std::int64_t j ) const {
+    const cell_t *t = tiles[ (i>>tile_shift)*tiles_n + (j>>tile_shift) ];
+    return ( t ? t : water_tile )[ ((i&(tile_side-1))<<tile_shift) | (j&(tile_side-1)) ];
+  } // End reading a cell
+
+  cell_t& operator () ( std::int64_t i , std::int64_t j ) {
+    return writable_tile( (i>>tile_shift)*tiles_n + (j>>tile_shift) )[ ((i&(tile_side-1))<<tile_shift) | (j&(tile_side-1)) ];
+  } // End getting a cell to write, which gives its tile memory if it had none
+
+  cell_t& operator [] ( std::int64_t k ) { return (*this)(k/n,k%n); } // Cell k in row major order
+
+  const cell_t* tile( std::int64_t ti , std::int64_t tj ) const { return tiles[ti*tiles_n+tj]; } // nullptr if all water
+
+  const cell_t* tile_or_water( std::int64_t ti , std::int64_t tj ) const {
+    const cell_t *t = tiles[ti*tiles_n+tj];
+    return t ? t : water_tile;
+  } // End getting a tile to read, the shared water tile if it has no memory
+
+  cell_t* writable_tile( std::int64_t ti , std::int64_t tj ) { return writable_tile(ti*tiles_n+tj); }
+
+  void release( std::int64_t ti , std::int64_t tj ) {
+    // Tile (ti,tj) is all water again, so it goes back to the free list
+    cell_t *&t = tiles[ti*tiles_n+tj];
+    if ( !t ) { return; }
+    free_tiles.push_back(t);
+    t = nullptr;
+    n_allocated--;
+  } // End releasing a tile
+
+  void fill( const cell_t &value ) {
+    const cell_t water{};
+    if ( std::memcmp(&value,&water,sizeof(cell_t)) == 0 ) {
+      for (std::int64_t t=0 ; t<(std::int64_t)tiles.size() ; t++) { release(t/tiles_n,t%tiles_n); }
+      return;
+    } // Filling with water is releasing everything
+    for (std::size_t t=0 ; t<tiles.size() ; t++) {
+      cell_t *p = writable_tile(t);
+      std::fill(p,p+tile_cells,value);
+    } // End loop over tiles
+  } // End filling every cell
+}; // End of cell storage class
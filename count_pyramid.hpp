@@ -0,0 +1,161 @@
+#pragma once // Guard multiple instances
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+
+class count_pyramid {
+  // How many cells of each type there are in every 64x64 tile of a grid
+  // (level 0), in every 2x2 block of tiles (level 1), every 2x2 block of
+  // those, and so on up to a single node for the whole grid.
+  // A cell change updates one node per level, so O(log N). The totals and
+  // the count of any node are O(1), and a uniformly random cell of a type is
+  // found by walking down from the top in O(log N). A rectangle is not O(1):
+  // it is the nodes it covers plus the cells of the tiles cut by its edges,
+  // so an h x w rectangle whose edges are off the tile boundaries reads up
+  // to about 2*(h+w)*64 cells. Rectangles on tile boundaries cost only the
+  // O(log N) nodes along their edges.
+public:
+  static constexpr int n_types = 4; // One count per cell_type
+  static constexpr int tile_shift = 6; // Must match the tiles of the cell storage
+  static constexpr int tile_side = 1<<tile_shift;
+  using counts = std::array<std::int64_t,n_types>;
+private:
+  std::int64_t m{0} , n{0};
+  std::vector<std::pair<std::int64_t,std::int64_t>> dims; // Node rows and columns of each level
+  std::vector<std::vector<counts>> levels; // Level 0 is the tiles, the last level is one node
+
+  counts& node( int level , std::int64_t a , std::int64_t b ) { return levels[level][a*dims[level].second+b]; }
+
+  template <class partial_t>
+  std::int64_t count_node( int level , std::int64_t a , std::int64_t b , int t ,
+			   std::int64_t i0 , std::int64_t j0 , std::int64_t i1 , std::int64_t j1 , partial_t &partial ) {
+    int shift = level+tile_shift;
+    std::int64_t ni0 = a<<shift , nj0 = b<<shift;
+    std::int64_t ni1 = std::min(m,(a+1)<<shift) , nj1 = std::min(n,(b+1)<<shift);
+    if ( ni1<=i0 || ni0>=i1 || nj1<=j0 || nj0>=j1 ) { return 0; } // No overlap
+    if ( i0<=ni0 && ni1<=i1 && j0<=nj0 && nj1<=j1 ) { return node(level,a,b)[t]; } // Covered
+    if ( level == 0 ) {
+      return partial( std::max(i0,ni0) , std::max(j0,nj0) , std::min(i1,ni1) , std::min(j1,nj1) );
+    } // Tile cut by the edge of the rectangle, so count its cells
+    std::int64_t sum = 0;
+    for (std::int64_t ca=2*a ; ca<std::min(2*a+2,dims[level-1].first) ; ca++) {
+      for (std::int64_t cb=2*b ; cb<std::min(2*b+2,dims[level-1].second) ; cb++) {
+	sum += count_node(level-1,ca,cb,t,i0,j0,i1,j1,partial);
+      } // End loop over child columns
+    } // End loop over child rows
+    return sum;
+  } // End counting inside one node
+public:
+  count_pyramid() = default;
+  count_pyramid( std::int64_t rows , std::int64_t cols ) { resize(rows,cols); }
+
+  void resize( std::int64_t rows , std::int64_t cols ) {
+    // Sets up the levels for a rows x cols grid of open water (type 0)
+    m = rows;
+    n = cols;
+    dims.clear();
+    levels.clear();
+    std::int64_t dm = std::max<std::int64_t>(1,(m+tile_side-1)>>tile_shift);
+    std::int64_t dn = std::max<std::int64_t>(1,(n+tile_side-1)>>tile_shift);
+    while ( true ) {
+      dims.push_back({dm,dn});
+      levels.emplace_back(dm*dn,counts{});
+      if ( dm==1 && dn==1 ) { break; }
+      dm = (dm+1)/2;
+      dn = (dn+1)/2;
+    } // End adding levels
+    fill(0);
+  } // End sizing the pyramid
+
+  void fill( int t ) {
+    // Every cell is of type t
+    for (std::int64_t ti=0 ; ti<dims[0].first ; ti++) {
+      for (std::int64_t tj=0 ; tj<dims[0].second ; tj++) {
+	counts c{};
+	c[t] = valid_cells(ti,tj);
+	node(0,ti,tj) = c;
+      } // End loop over tile columns
+    } // End loop over tile rows
+    rebuild();
+  } // End filling with one type
+
+  void set_tile( std::int64_t ti , std::int64_t tj , const counts &c ) { node(0,ti,tj) = c; } // Call rebuild() after
+
+  void rebuild() {
+    // Sums every level from the one below it
+    for (std::size_t level=1 ; level<levels.size() ; level++) {
+      auto [dm,dn] = dims[level];
+      for (std::int64_t a=0 ; a<dm ; a++) {
+	for (std::int64_t b=0 ; b<dn ; b++) {
+	  counts sum{};
+	  for (std::int64_t ca=2*a ; ca<std::min(2*a+2,dims[level-1].first) ; ca++) {
+	    for (std::int64_t cb=2*b ; cb<std::min(2*b+2,dims[level-1].second) ; cb++) {
+	      const counts &c = node(level-1,ca,cb);
+	      for (int t=0 ; t<n_types ; t++) { sum[t] += c[t]; }
+	    } // End loop over child columns
+	  } // End loop over child rows
+	  node(level,a,b) = sum;
+	} // End loop over node columns
+      } // End loop over node rows
+    } // End loop over levels
+  } // End rebuilding the upper levels
+
+  void change( std::int64_t i , std::int64_t j , int from , int to ) {
+    // Cell (i,j) went from type from to type to
+    if ( from == to ) { return; }
+    std::int64_t a = i>>tile_shift , b = j>>tile_shift;
+    for (std::size_t level=0 ; level<levels.size() ; level++) {
+      counts &c = node(level,a,b);
+      c[from]--;
+      c[to]++;
+      a >>= 1;
+      b >>= 1;
+    } // End loop over levels
+  } // End recording a change
+
+  std::int64_t valid_cells( std::int64_t ti , std::int64_t tj ) {
+    // Cells of tile (ti,tj) that are inside the grid, edge tiles are cut short
+    return std::min<std::int64_t>(tile_side,m-(ti<<tile_shift)) * std::min<std::int64_t>(tile_side,n-(tj<<tile_shift));
+  } // End counting the cells of a tile
+
+  std::int64_t total( int t ) { return levels.back()[0][t]; }
+
+  std::int64_t tile_count( std::int64_t ti , std::int64_t tj , int t ) { return node(0,ti,tj)[t]; }
+
+  template <class partial_t>
+  std::int64_t count_region( int t , std::int64_t i0 , std::int64_t j0 , std::int64_t i1 , std::int64_t j1 , partial_t partial ) {
+    // Cells of type t with i0<=i<i1 and j0<=j<j1. partial(i0,j0,i1,j1) counts
+    // them cell by cell inside a single tile, once for every tile the edges
+    // cut, so the cost grows with the perimeter (see above).
+    i0 = std::max<std::int64_t>(i0,0);
+    j0 = std::max<std::int64_t>(j0,0);
+    i1 = std::min(i1,m);
+    j1 = std::min(j1,n);
+    if ( i0>=i1 || j0>=j1 ) { return 0; }
+    return count_node((int)levels.size()-1,0,0,t,i0,j0,i1,j1,partial);
+  } // End counting a region
+
+  std::pair<std::int64_t,std::int64_t> find_tile( int t , std::int64_t &k ) {
+    // Tile holding the k-th cell of type t (0 <= k < total(t)), counting tile
+    // by tile down the pyramid. On return k is the index within that tile.
+    std::int64_t a = 0 , b = 0;
+    for (int level=(int)levels.size()-1 ; level>0 ; level--) {
+      bool found = false;
+      for (std::int64_t ca=2*a ; ca<std::min(2*a+2,dims[level-1].first) && !found ; ca++) {
+	for (std::int64_t cb=2*b ; cb<std::min(2*b+2,dims[level-1].second) && !found ; cb++) {
+	  std::int64_t c = node(level-1,ca,cb)[t];
+	  if ( k < c ) {
+	    a = ca;
+	    b = cb;
+	    found = true;
+	  }
+	  else { k -= c; }
+	} // End loop over child columns
+      } // End loop over child rows
+    } // End walking down the levels
+    return {a,b};
+  } // End finding the tile of a cell
+}; // End of count pyramid class
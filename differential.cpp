@@ -0,0 +1,464 @@
+// Differential test of the sweep model: runs the ocean class (the candidate,
+// with its tiles, count pyramid, rule table and pooled buffers) against a
+// reference that writes the same model out plainly on row major vectors, on
+// randomized oceans of many shapes, densities and settings.
+//   exact: both start from the same seed and visit cells in the same order
+//          (the candidate's tile order), so they draw the same random numbers
+//          for the same things and every timestep must match cell for cell
+//   stat:  the reference visits cells row by row instead, so the runs part
+//          ways, and the end states of many runs of each are compared with
+//          Kolmogorov-Smirnov tests (turtle and garbage counts, how far the
+//          ships are from the middle) and chi square tests (which 4x4 block
+//          of the ocean the middle of the ships and of the turtles is in)
+// Both check the invariants every timestep: the ships are all still there
+// (two agents never end up in one cell), turtles and garbage never appear
+// outside reproduction, nothing moves more than one cell, and the
+// candidate's counts agree with its cells.
+// --alpha is the chance of any statistical test failing by chance over the
+// whole run. Exits with 1 if anything fails.
+//
+// Usage: differential [--configs 10] [--steps 40] [--replicates 50] [--min_size 8]
+//                     [--max_size 200] [--mode exact|stat|both] [--alpha 0.01] [--seed 322]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "ocean.hpp"
+
+enum class scan_policy { tile , row_major };
+
+class reference_ocean {
+  // The sweep model with nothing clever in it: two row major vectors of
+  // cells, every count by looking at every cell, and the interaction rules
+  // spelled out. Cells are visited in the order of the scan policy; with the
+  // tile policy that is the order the ocean class visits them in, so given
+  // the same engine the two make the same draws for the same decisions.
+public:
+  int m , n;
+  std::vector<cell_type> last , current;
+  ocean_engine rng;
+
+  reference_ocean( int m , int n , scan_policy policy ) : m(m) , n(n) , last((std::size_t)m*n,cell_type::water_only) ,
+							  current((std::size_t)m*n,cell_type::water_only) {
+    if ( policy == scan_policy::row_major ) {
+      for ( std::int64_t k=0 ; k<(std::int64_t)m*n ; k++ ) { order.push_back(k); }
+      sample_order = order;
+      return;
+    }
+    // The ocean class finds movers tile by tile in row major order, and open
+    // cells by walking its count pyramid, which takes the tiles in quadtree
+    // (Morton) order; either way the cells of a tile are row major
+    constexpr int side = cell_storage<cell>::tile_side;
+    std::vector<std::pair<int,int>> tiles;
+    for ( int ti=0 ; ti*side<m ; ti++ ) {
+      for ( int tj=0 ; tj*side<n ; tj++ ) { tiles.push_back({ti,tj}); }
+    } // End loop over tiles
+    auto add_tiles = [&]( std::vector<std::int64_t> &cells ) {
+      for ( auto [ti,tj] : tiles ) {
+	for ( int r=ti*side ; r<std::min(m,(ti+1)*side) ; r++ ) {
+	  for ( int c=tj*side ; c<std::min(n,(tj+1)*side) ; c++ ) { cells.push_back((std::int64_t)r*n+c); }
+	} // End loop over rows of the tile
+      } // End loop over tiles
+    };
+    add_tiles(order);
+    auto morton = []( std::pair<int,int> t ) {
+      std::uint64_t key = 0;
+      for ( int bit=0 ; bit<31 ; bit++ ) {
+	key |= (std::uint64_t)((t.first>>bit)&1) << (2*bit+1) | (std::uint64_t)((t.second>>bit)&1) << (2*bit);
+      }
+      return key;
+    };
+    std::stable_sort(tiles.begin(),tiles.end(),[&]( auto a , auto b ) { return morton(a) < morton(b); });
+    add_tiles(sample_order);
+  } // End constructor
+
+  cell_type& at( std::vector<cell_type> &g , int i , int j ) { return g[(std::size_t)i*n+j]; }
+
+  std::int64_t count( cell_type ct ) { return std::count(last.begin(),last.end(),ct); }
+
+  void initiate_grid( int ships , int turtles , int garbage ) {
+    std::int64_t occupied = (std::int64_t)ships+turtles+garbage;
+    std::int64_t cells = (std::int64_t)m*n;
+    if ( 2*occupied > cells ) {
+      // Crowded: everything in a row, then a Fisher-Yates shuffle of the cells
+      std::int64_t k = 0;
+      for ( int s=0 ; s<ships ; s++ ) { last[k++] = cell_type::ship; }
+      for ( int t=0 ; t<turtles ; t++ ) { last[k++] = cell_type::turtle; }
+      for ( int g=0 ; g<garbage ; g++ ) { last[k++] = cell_type::garbage; }
+      for ( k=cells-1 ; k>0 ; k-- ) { std::swap(last[k],last[rng.below(k+1)]); }
+      return;
+    }
+    // Mostly water: one at a time on a random open cell
+    open_water();
+    for ( int s=0 ; s<ships ; s++ ) { place_randomly(cell_type::ship); }
+    for ( int t=0 ; t<turtles ; t++ ) { place_randomly(cell_type::turtle); }
+    for ( int g=0 ; g<garbage ; g++ ) { place_randomly(cell_type::garbage); }
+  } // End placing everything
+
+  void step_forward( bool smart_ships ) {
+    // Garbage stays put, then every ship and turtle tries to move in a random order
+    for ( std::size_t k=0 ; k<last.size() ; k++ ) {
+      current[k] = last[k] == cell_type::garbage ? cell_type::garbage : cell_type::water_only;
+    } // End copying the garbage
+
+    std::vector<std::int64_t> movers;
+    for ( std::int64_t k : order ) {
+      if ( last[k] == cell_type::ship || last[k] == cell_type::turtle ) { movers.push_back(k); }
+    } // End finding the movers
+    rng.shuffle(movers.begin(),movers.end());
+
+    for ( std::int64_t k : movers ) {
+      int i = k/n , j = k%n;
+      cell_type mover = last[k];
+      auto [new_i,new_j] = mover == cell_type::ship && smart_ships ? smart_move(i,j) : random_move(i,j);
+      if ( new_i == i && new_j == j ) {
+	at(current,i,j) = mover;
+	continue;
+      } // Stuck
+      cell_type &dest = at(current,new_i,new_j);
+      if ( mover == cell_type::turtle && dest == cell_type::garbage ) { dest = cell_type::garbage; } // Turtle dies
+      else { dest = mover; } // A ship on garbage picks it up
+      at(current,i,j) = cell_type::water_only;
+    } // End loop over movers
+    std::swap(last,current);
+  } // End one step of motion
+
+  void reproduce_turtles( double rate ) {
+    std::int64_t turtles = count(cell_type::turtle);
+    std::int64_t births = std::llround(rate*turtles - turtles);
+    open_water();
+    for ( std::int64_t b=0 ; b<births ; b++ ) {
+      if ( !place_randomly(cell_type::turtle) ) { break; }
+    } // End loop over births
+  } // End reproducing turtles
+
+  void advance( int t , double turtle_rate , int turtle_steps , bool smart_ships ) {
+    step_forward(smart_ships);
+    if ( t%turtle_steps == 0 ) { reproduce_turtles(turtle_rate); }
+  } // End one timestep
+private:
+  std::vector<std::int64_t> order; // Every cell, in the order movers are found
+  std::vector<std::int64_t> sample_order; // Every cell, in the order open cells are counted off
+  std::vector<std::int64_t> water; // Open cells of the last grid in scan order, while placing things
+
+  static constexpr int delta_i[8] = {1,1,1,0,-1,-1,-1,0};
+  static constexpr int delta_j[8] = {-1,0,1,1,1,0,-1,-1};
+
+  void open_water() {
+    water.clear();
+    for ( std::int64_t k : sample_order ) { if ( last[k] == cell_type::water_only ) { water.push_back(k); } }
+  } // End listing the open cells
+
+  bool place_randomly( cell_type t ) {
+    if ( water.empty() ) { return false; }
+    auto it = water.begin() + rng.below(water.size());
+    last[*it] = t;
+    water.erase(it);
+    return true;
+  } // End placing something on a random open cell
+
+  bool allowed( int i , int j ) {
+    // Ships and turtles stay on the grid and never go where a ship or turtle is or was
+    if ( i<0 || j<0 || i>=m || j>=n ) { return false; }
+    for ( cell_type c : { at(last,i,j) , at(current,i,j) } ) {
+      if ( c == cell_type::ship || c == cell_type::turtle ) { return false; }
+    }
+    return true;
+  } // End checking a move
+
+  std::pair<int,int> random_move( int i , int j ) {
+    for ( int tries=0 ; tries<100 ; tries++ ) {
+      int d = rng.direction();
+      if ( allowed(i+delta_i[d],j+delta_j[d]) ) { return {i+delta_i[d],j+delta_j[d]}; }
+    } // End loop over tries
+    return {i,j};
+  } // End moving randomly
+
+  std::pair<int,int> smart_move( int i , int j ) {
+    // Onto the first garbage around, otherwise randomly
+    for ( int d=0 ; d<8 ; d++ ) {
+      int ii = i+delta_i[d] , jj = j+delta_j[d];
+      if ( ii>=0 && jj>=0 && ii<m && jj<n && at(current,ii,jj) == cell_type::garbage ) { return {ii,jj}; }
+    } // End loop over neighbors
+    return random_move(i,j);
+  } // End moving a smart ship
+}; // End of reference ocean class
+
+struct diff_config {
+  int rows , cols;
+  int ships , turtles , garbage;
+  double turtle_rate;
+  int turtle_steps;
+  bool smart;
+  std::uint64_t seed;
+};
+
+std::string describe( const diff_config &c ) {
+  std::stringstream ss;
+  ss << c.rows << "x" << c.cols << " ships " << c.ships << " turtles " << c.turtles << " garbage " << c.garbage
+     << " rate " << c.turtle_rate << "/" << c.turtle_steps << (c.smart ? " smart" : "") << " seed " << c.seed;
+  return ss.str();
+} // End describing a configuration
+
+diff_config random_config( ocean_engine &rng , int min_size , int max_size ) {
+  // Any shape, including ones that end partway into a tile, and densities from nearly empty to full
+  diff_config c;
+  c.rows = min_size + rng.below(max_size-min_size+1);
+  c.cols = min_size + rng.below(max_size-min_size+1);
+  std::int64_t cells = (std::int64_t)c.rows*c.cols;
+  double density = std::pow(rng.uniform(),2.0); // Mostly sparse, sometimes crowded
+  std::int64_t occupied = std::max<std::int64_t>(1,density*cells);
+  c.ships = std::max<std::int64_t>(1,occupied*rng.uniform()*0.3);
+  c.turtles = std::max<std::int64_t>(0,(occupied-c.ships)*rng.uniform());
+  c.garbage = std::max<std::int64_t>(0,std::min<std::int64_t>(occupied,cells)-c.ships-c.turtles);
+  c.turtle_rate = 1.0 + 0.5*rng.uniform();
+  c.turtle_steps = 1 + rng.below(5);
+  c.smart = rng.below(2);
+  c.seed = rng();
+  return c;
+} // End drawing a configuration
+
+struct census {
+  std::array<std::int64_t,n_cell_types> counts{};
+  std::vector<cell_type> cells;
+};
+
+census take_census( grid_2d &g ) {
+  census c;
+  c.cells.reserve((std::size_t)g.rows()*g.cols());
+  for ( int i=0 ; i<g.rows() ; i++ ) {
+    for ( int j=0 ; j<g.cols() ; j++ ) {
+      c.cells.push_back(g.get_cell_type(i,j));
+      c.counts[static_cast<int>(c.cells.back())]++;
+    }
+  } // End loop over the cells
+  return c;
+} // End taking a census of a grid
+
+census take_census( reference_ocean &r ) {
+  census c;
+  c.cells = r.last;
+  for ( cell_type t : c.cells ) { c.counts[static_cast<int>(t)]++; }
+  return c;
+} // End taking a census of the reference
+
+std::string check_invariants( const census &before , const census &after , int rows , int cols , bool reproduced ) {
+  // Empty if the step from before to after could have happened, otherwise what went wrong
+  auto ships = [&]( const census &c ) { return c.counts[static_cast<int>(cell_type::ship)]; };
+  auto turtles = [&]( const census &c ) { return c.counts[static_cast<int>(cell_type::turtle)]; };
+  auto garbage = [&]( const census &c ) { return c.counts[static_cast<int>(cell_type::garbage)]; };
+  if ( ships(after) != ships(before) ) { return "ship count changed from "+std::to_string(ships(before))+" to "+std::to_string(ships(after)); }
+  if ( garbage(after) > garbage(before) ) { return "garbage appeared"; }
+  if ( garbage(before)-garbage(after) > ships(before) ) { return "more garbage picked up than there are ships"; }
+  if ( !reproduced && turtles(after) > turtles(before) ) { return "turtles appeared without reproducing"; }
+  for ( int i=0 ; i<rows ; i++ ) {
+    for ( int j=0 ; j<cols ; j++ ) {
+      cell_type t = after.cells[(std::size_t)i*cols+j];
+      if ( t != cell_type::ship && (t != cell_type::turtle || reproduced) ) { continue; }
+      bool from_nearby = false;
+      for ( int ii=std::max(0,i-1) ; ii<=std::min(rows-1,i+1) ; ii++ ) {
+	for ( int jj=std::max(0,j-1) ; jj<=std::min(cols-1,j+1) ; jj++ ) { from_nearby |= before.cells[(std::size_t)ii*cols+jj] == t; }
+      }
+      if ( !from_nearby ) { return "agent at ("+std::to_string(i)+","+std::to_string(j)+") moved more than one cell"; }
+    } // End loop over columns
+  } // End loop over rows
+  return "";
+} // End checking the invariants of a step
+
+std::string run_exact( const diff_config &c , int steps ) {
+  // Lock step run, empty if every timestep matched and kept the invariants
+  seed_engine(c.seed);
+  ocean candidate(c.rows,c.cols,0);
+  candidate.initiate_grid(c.ships,c.turtles,c.garbage);
+  reference_ocean reference(c.rows,c.cols,scan_policy::tile);
+  reference.rng.seed(c.seed);
+  reference.initiate_grid(c.ships,c.turtles,c.garbage);
+
+  census cand_before = take_census(candidate.get_grid()) , ref_before = take_census(reference);
+  if ( cand_before.cells != ref_before.cells ) { return "initial grids differ"; }
+  for ( const ocean_frame &frame : candidate.frames(steps,c.turtle_rate,c.turtle_steps,c.smart,false,false,1.0,0.0) ) {
+    reference.advance(frame.t,c.turtle_rate,c.turtle_steps,c.smart);
+    census cand = take_census(frame.grid()) , ref = take_census(reference);
+    std::string where = " at timestep "+std::to_string(frame.t);
+    for ( int t=0 ; t<n_cell_types ; t++ ) {
+      if ( frame.count(static_cast<cell_type>(t)) != cand.counts[t] ) { return "candidate counts disagree with its cells"+where; }
+    }
+    bool reproduced = frame.t%c.turtle_steps == 0;
+    std::string broken = check_invariants(cand_before,cand,c.rows,c.cols,reproduced);
+    if ( !broken.empty() ) { return "candidate: "+broken+where; }
+    broken = check_invariants(ref_before,ref,c.rows,c.cols,reproduced);
+    if ( !broken.empty() ) { return "reference: "+broken+where; }
+    auto mismatch = std::mismatch(cand.cells.begin(),cand.cells.end(),ref.cells.begin());
+    if ( mismatch.first != cand.cells.end() ) {
+      std::int64_t k = mismatch.first-cand.cells.begin();
+      return "grids differ at ("+std::to_string(k/c.cols)+","+std::to_string(k%c.cols)+")"+where;
+    }
+    cand_before = std::move(cand);
+    ref_before = std::move(ref);
+  } // End loop over timesteps
+  return "";
+} // End the exact comparison
+
+double ks_p_value( std::vector<double> a , std::vector<double> b ) {
+  // Two sample Kolmogorov-Smirnov test, p value from the asymptotic distribution
+  std::sort(a.begin(),a.end());
+  std::sort(b.begin(),b.end());
+  double d = 0.0;
+  std::size_t i = 0 , j = 0;
+  while ( i<a.size() && j<b.size() ) {
+    double x = std::min(a[i],b[j]);
+    while ( i<a.size() && a[i] == x ) { i++; }
+    while ( j<b.size() && b[j] == x ) { j++; }
+    d = std::max(d,std::abs((double)i/a.size()-(double)j/b.size()));
+  } // End walking both samples
+  double ne = (double)a.size()*b.size()/(a.size()+b.size());
+  double lambda = (std::sqrt(ne)+0.12+0.11/std::sqrt(ne))*d;
+  if ( lambda < 0.2 ) { return 1.0; }
+  double p = 0.0;
+  for ( int k=1 ; k<=100 ; k++ ) { p += 2*((k%2) ? 1 : -1)*std::exp(-2*k*k*lambda*lambda); }
+  return std::clamp(p,0.0,1.0);
+} // End the Kolmogorov-Smirnov test
+
+double chi_square_p_value( const std::vector<double> &a , const std::vector<double> &b ) {
+  // Chi square test that two histograms come from the same distribution,
+  // bins with fewer than 10 counts pooled into one, p value with the
+  // Wilson-Hilferty normal approximation
+  std::vector<std::pair<double,double>> bins;
+  std::pair<double,double> sparse{0.0,0.0};
+  for ( std::size_t k=0 ; k<a.size() ; k++ ) {
+    if ( a[k]+b[k] >= 10 ) { bins.push_back({a[k],b[k]}); }
+    else { sparse.first += a[k]; sparse.second += b[k]; }
+  } // End pooling the sparse bins
+  if ( sparse.first+sparse.second > 0 ) { bins.push_back(sparse); }
+  double total_a = 0.0 , total_b = 0.0;
+  for ( auto [x,y] : bins ) { total_a += x; total_b += y; }
+  int dof = (int)bins.size()-1;
+  if ( total_a == 0.0 || total_b == 0.0 || dof < 1 ) { return 1.0; }
+  double chi2 = 0.0;
+  for ( auto [x,y] : bins ) {
+    double expect_a = (x+y)*total_a/(total_a+total_b) , expect_b = (x+y)*total_b/(total_a+total_b);
+    chi2 += (x-expect_a)*(x-expect_a)/expect_a + (y-expect_b)*(y-expect_b)/expect_b;
+  } // End loop over bins
+  double z = (std::cbrt(chi2/dof) - (1.0-2.0/(9*dof)))/std::sqrt(2.0/(9*dof));
+  return 0.5*std::erfc(z/std::sqrt(2.0));
+} // End the chi square test
+
+struct end_states {
+  // One of each per run, so the samples are independent
+  std::vector<double> turtles , garbage;
+  std::vector<double> ship_spread; // Mean distance of the ships from the middle, over the half diagonal
+  std::vector<double> ship_blocks , turtle_blocks; // Runs whose centroid is in each 4x4 block of the ocean, then runs with none
+};
+
+void record( end_states &e , const census &c , int rows , int cols ) {
+  e.turtles.push_back(c.counts[static_cast<int>(cell_type::turtle)]);
+  e.garbage.push_back(c.counts[static_cast<int>(cell_type::garbage)]);
+  e.ship_blocks.resize(17);
+  e.turtle_blocks.resize(17);
+  double ship_i = 0 , ship_j = 0 , turtle_i = 0 , turtle_j = 0 , spread = 0;
+  double mid_i = (rows-1)/2.0 , mid_j = (cols-1)/2.0;
+  for ( int i=0 ; i<rows ; i++ ) {
+    for ( int j=0 ; j<cols ; j++ ) {
+      cell_type t = c.cells[(std::size_t)i*cols+j];
+      if ( t == cell_type::ship ) { ship_i += i; ship_j += j; spread += std::hypot(i-mid_i,j-mid_j); }
+      if ( t == cell_type::turtle ) { turtle_i += i; turtle_j += j; }
+    }
+  } // End loop over the cells
+  auto block = [&]( double sum_i , double sum_j , std::int64_t count ) {
+    if ( count == 0 ) { return 16; }
+    return std::min(3,(int)(4*sum_i/count/rows))*4 + std::min(3,(int)(4*sum_j/count/cols));
+  };
+  std::int64_t ships = c.counts[static_cast<int>(cell_type::ship)];
+  e.ship_blocks[block(ship_i,ship_j,ships)]++;
+  e.turtle_blocks[block(turtle_i,turtle_j,e.turtles.back())]++;
+  e.ship_spread.push_back( ships ? spread/ships/std::max(0.5,std::hypot(mid_i,mid_j)) : 0.0 );
+} // End recording an end state
+
+std::string run_stat( const diff_config &c , int steps , int replicates , double alpha ) {
+  // Independent runs of each, empty if no test rejects at alpha and the invariants held
+  end_states cand_end , ref_end;
+  for ( int r=0 ; r<replicates ; r++ ) {
+    seed_engine(simulation_seed(c.seed,r));
+    ocean candidate(c.rows,c.cols,0);
+    candidate.initiate_grid(c.ships,c.turtles,c.garbage);
+    census before = take_census(candidate.get_grid());
+    for ( const ocean_frame &frame : candidate.frames(steps,c.turtle_rate,c.turtle_steps,c.smart,false,false,1.0,0.0) ) {
+      census now = take_census(frame.grid());
+      std::string broken = check_invariants(before,now,c.rows,c.cols,frame.t%c.turtle_steps == 0);
+      if ( !broken.empty() ) { return "candidate: "+broken+" at timestep "+std::to_string(frame.t); }
+      before = std::move(now);
+    } // End loop over timesteps
+    record(cand_end,before,c.rows,c.cols);
+
+    reference_ocean reference(c.rows,c.cols,scan_policy::row_major);
+    reference.rng.seed(simulation_seed(~c.seed,r));
+    reference.initiate_grid(c.ships,c.turtles,c.garbage);
+    before = take_census(reference);
+    for ( int t=0 ; t<steps ; t++ ) {
+      reference.advance(t,c.turtle_rate,c.turtle_steps,c.smart);
+      census now = take_census(reference);
+      std::string broken = check_invariants(before,now,c.rows,c.cols,t%c.turtle_steps == 0);
+      if ( !broken.empty() ) { return "reference: "+broken+" at timestep "+std::to_string(t); }
+      before = std::move(now);
+    } // End loop over timesteps
+    record(ref_end,before,c.rows,c.cols);
+  } // End loop over replicates
+
+  std::stringstream failed;
+  failed << std::setprecision(3);
+  double p;
+  if ( (p = ks_p_value(cand_end.turtles,ref_end.turtles)) < alpha ) { failed << "turtles KS p=" << p << " "; }
+  if ( (p = ks_p_value(cand_end.garbage,ref_end.garbage)) < alpha ) { failed << "garbage KS p=" << p << " "; }
+  if ( (p = ks_p_value(cand_end.ship_spread,ref_end.ship_spread)) < alpha ) { failed << "ship spread KS p=" << p << " "; }
+  if ( (p = chi_square_p_value(cand_end.ship_blocks,ref_end.ship_blocks)) < alpha ) { failed << "ship centroid chi2 p=" << p << " "; }
+  if ( (p = chi_square_p_value(cand_end.turtle_blocks,ref_end.turtle_blocks)) < alpha ) { failed << "turtle centroid chi2 p=" << p << " "; }
+  return failed.str();
+} // End the statistical comparison
+
+int main( int argc , char **argv ) {
+  int n_configs = 10 , steps = 40 , replicates = 50 , min_size = 8 , max_size = 200;
+  std::string mode = "both";
+  double alpha = 0.01; // Chance of a false alarm anywhere in the run
+  std::uint64_t seed = 322;
+  for ( int a=1 ; a+1<argc ; a+=2 ) {
+    std::string flag = argv[a];
+    if      ( flag == "--configs" )    { n_configs = std::atoi(argv[a+1]); }
+    else if ( flag == "--steps" )      { steps = std::atoi(argv[a+1]); }
+    else if ( flag == "--replicates" ) { replicates = std::max(2,std::atoi(argv[a+1])); }
+    else if ( flag == "--min_size" )   { min_size = std::max(1,std::atoi(argv[a+1])); }
+    else if ( flag == "--max_size" )   { max_size = std::atoi(argv[a+1]); }
+    else if ( flag == "--mode" )       { mode = argv[a+1]; }
+    else if ( flag == "--alpha" )      { alpha = std::atof(argv[a+1]); }
+    else if ( flag == "--seed" )       { seed = std::strtoull(argv[a+1],nullptr,10); }
+    else { std::cerr << "Unknown option " << flag << '\n'; return 1; }
+  } // End reading the options
+  if ( mode != "exact" && mode != "stat" && mode != "both" ) { std::cerr << "Unknown mode " << mode << '\n'; return 1; }
+  max_size = std::max(min_size,max_size);
+
+  ocean_engine rng(seed);
+  int failures = 0;
+  for ( int k=0 ; k<n_configs ; k++ ) {
+    diff_config c = random_config(rng,min_size,max_size);
+    std::cout << "config " << k << ": " << describe(c) << '\n';
+    if ( mode != "stat" ) {
+      std::string result = run_exact(c,steps);
+      std::cout << "  exact  " << ( result.empty() ? "ok" : "FAILED "+result ) << '\n';
+      failures += !result.empty();
+    }
+    if ( mode != "exact" ) {
+      std::string result = run_stat(c,steps,replicates,alpha/(5.0*n_configs)); // Bonferroni over the five tests of every configuration
+      std::cout << "  stat   " << ( result.empty() ? "ok" : "FAILED "+result ) << '\n';
+      failures += !result.empty();
+    }
+  } // End loop over configurations
+  std::cout << ( failures == 0 ? "All " + std::to_string(n_configs) + " configurations passed"
+		 : std::to_string(failures) + " checks failed" ) << '\n';
+  return failures == 0 ? 0 : 1;
+} // End of main
@@ -0,0 +1,106 @@
+#pragma once // Guard multiple instances
+
+#include "garbage_index.hpp"
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <tuple>
+#include <cstdint>
+
+class fleet_planner {
+  // Gives every ship its own piece of garbage to head for, so the fleet
+  // spreads out instead of every ship chasing the same piece.
+  // Every `every` timesteps plan() hands out targets with a greedy auction:
+  // each unassigned ship bids for its nearest unclaimed garbage, the bids are
+  // sorted by distance and accepted shortest first, and ships that lost bid
+  // again for whatever is left. When many ships want the same few pieces
+  // each round settles only one ship per piece, so after max_rounds the
+  // ships still bidding just take the nearest free piece one after another.
+  // Between plans a ship whose target was taken by someone else claims the
+  // nearest free piece the next time it moves.
+  // Ships and garbage are keyed by cell index (i*n_cols+j).
+private:
+  std::unordered_map<std::int64_t,std::int64_t> ship_target; // Ship cell -> garbage cell
+  std::unordered_map<std::int64_t,std::int64_t> target_ship; // Garbage cell -> ship cell
+  std::vector<std::int64_t> unassigned , losers;
+  std::vector<std::tuple<int,std::int64_t,std::int64_t>> bids; // (distance, ship, garbage)
+  int n{1};
+
+  int distance( std::int64_t a , std::int64_t b ) {
+    return std::max( std::abs((int)(a/n)-(int)(b/n)) , std::abs((int)(a%n)-(int)(b%n)) );
+  } // End moves between two cells
+
+  void claim( std::int64_t ship , std::int64_t garbage ) {
+    ship_target[ship] = garbage;
+    target_ship[garbage] = ship;
+  } // End giving a ship a target
+public:
+  int every{0}; // Replan every this many timesteps, 0 when the planner is off
+  static constexpr int max_rounds = 8; // Auction rounds before the rest are settled one by one
+  garbage_index index;
+
+  template <class is_garbage_t>
+  void build_index( int rows , int cols , is_garbage_t is_garbage ) {
+    n = cols;
+    index.build(rows,cols,is_garbage);
+    ship_target.clear();
+    target_ship.clear();
+  } // End indexing the garbage
+
+  void plan( const std::vector<std::int64_t> &ships ) {
+    // Greedy auction over all ships, O(ships * max_rounds) nearest queries and
+    // sorts of the bids. Left uncapped, a dense fleet around sparse garbage
+    // would take a round per piece, O(ships^2).
+    ship_target.clear();
+    target_ship.clear();
+    unassigned = ships;
+    auto free = [&](std::int64_t c) { return target_ship.find(c) == target_ship.end(); };
+    for ( int round=0 ; round<max_rounds && !unassigned.empty() && (std::int64_t)target_ship.size() < index.size() ; round++ ) {
+      bids.clear();
+      for ( std::int64_t s : unassigned ) {
+	std::int64_t g = index.nearest(s/n,s%n,free);
+	if ( g < 0 ) { continue; }
+	bids.push_back({distance(s,g),s,g});
+      } // End collecting bids
+      if ( bids.empty() ) { break; }
+      std::sort(bids.begin(),bids.end());
+      losers.clear();
+      for ( auto [d,s,g] : bids ) {
+	if ( free(g) ) { claim(s,g); }
+	else { losers.push_back(s); }
+      } // End accepting bids
+      unassigned.swap(losers);
+    } // End auction rounds
+
+    for ( std::int64_t s : unassigned ) {
+      if ( (std::int64_t)target_ship.size() == index.size() ) { break; }
+      std::int64_t g = index.nearest(s/n,s%n,free);
+      if ( g >= 0 ) { claim(s,g); }
+    } // End settling the ships still bidding, nearest free piece first come
+  } // End planning targets for the fleet
+
+  std::int64_t target_of( std::int64_t ship ) {
+    // Garbage cell this ship is heading for, claiming the nearest free one if it has none
+    auto it = ship_target.find(ship);
+    if ( it != ship_target.end() ) { return it->second; }
+    std::int64_t g = index.nearest(ship/n,ship%n,[&](std::int64_t c) { return target_ship.find(c) == target_ship.end(); });
+    if ( g >= 0 ) { claim(ship,g); }
+    return g;
+  } // End getting a ship's target
+
+  void ship_moved( std::int64_t from , std::int64_t to ) {
+    auto it = ship_target.find(from);
+    if ( it == ship_target.end() ) { return; }
+    std::int64_t g = it->second;
+    ship_target.erase(it);
+    claim(to,g);
+  } // End following a ship to its new cell
+
+  void garbage_removed( std::int64_t garbage ) {
+    index.remove(garbage);
+    auto it = target_ship.find(garbage);
+    if ( it == target_ship.end() ) { return; }
+    ship_target.erase(it->second);
+    target_ship.erase(it);
+  } // End removing collected garbage
+}; // End of fleet planner class
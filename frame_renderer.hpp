@@ -0,0 +1,192 @@
+#pragma once // Guard multiple instances
+
+#include "grid.hpp"
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+
+class frame_renderer {
+  // Draws the grid to the terminal as an animation. The whole frame is built in
+  // one buffer and written with a single call, and ANSI cursor codes are used to
+  // redraw only the rows that changed since the last frame.
+private:
+  std::vector<std::string> last_rows; // Rows as they are currently on screen
+  std::string last_status;
+  std::string frame , row; // Reused buffers so we do not allocate every frame
+public:
+  ~frame_renderer() { finish(); }
+
+  template <class row_fn>
+  void draw( int m , row_fn &&append_row , const std::string &status ) {
+    // Draws m rows, append_row(i,out) appending the characters of row i onto out
+    frame.clear();
+
+    // First frame (or a new grid size) clears the screen and hides the cursor
+    if ( (int)last_rows.size() != m ) {
+      frame += "\x1b[?25l\x1b[2J";
+      last_rows.assign(m,"");
+      last_status.clear();
+    } // End setting up the screen
+
+    for (int i=0 ; i<m ; i++) {
+      row.clear();
+      append_row(i,row);
+      if ( row == last_rows[i] ) { continue; }
+      frame += "\x1b[" + std::to_string(i+1) + ";1H";
+      frame += row;
+      last_rows[i].swap(row);
+    } // End loop over the rows
+
+    if ( status != last_status ) {
+      frame += "\x1b[" + std::to_string(m+1) + ";1H\x1b[2K" + status;
+      last_status = status;
+    } // End updating the status line
+
+    std::fwrite(frame.data(),1,frame.size(),stdout);
+    std::fflush(stdout);
+  } // End drawing a frame
+
+  void draw( grid_2d &g , const std::string &status ) {
+    draw(g.rows(),[&](int i, std::string &out) { g.append_row(i,out); },status);
+  } // End drawing a grid
+
+  void finish() {
+    // Put the cursor below the animation and show it again
+    if ( last_rows.empty() ) { return; }
+    std::string tail = "\x1b[" + std::to_string(last_rows.size()+2) + ";1H\x1b[?25h";
+    std::fwrite(tail.data(),1,tail.size(),stdout);
+    std::fflush(stdout);
+    last_rows.clear();
+  } // End finishing the animation
+}; // End of frame renderer class
+
+// RGB color for each cell type, indexed by the enum value
+inline std::array<std::uint8_t,3> cell_color( cell_type t ) {
+  static constexpr std::uint8_t colors[4][3] = {
+    {  20 ,  60 , 160 }, // water
+    {  40 , 180 ,  80 }, // turtle
+    { 235 , 235 , 235 }, // ship
+    { 170 ,  90 ,  40 }  // garbage
+  };
+  auto &c = colors[ static_cast<int>(t) ];
+  return { c[0] , c[1] , c[2] };
+} // End getting the color for a cell type
+
+class image_writer {
+  // Writes the grid out as a PPM or PNG image, scale x scale pixels per cell.
+  // PNG files are written with uncompressed (stored) deflate blocks so we do
+  // not need zlib or any other library.
+private:
+  std::vector<std::uint8_t> pixels; // One scanline at a time
+  std::array<std::uint32_t,256> crc_table;
+
+  void build_crc_table() {
+    for (std::uint32_t k=0 ; k<256 ; k++) {
+      std::uint32_t c = k;
+      for (int b=0 ; b<8 ; b++) { c = (c&1) ? 0xedb88320u ^ (c>>1) : c>>1; }
+      crc_table[k] = c;
+    } // End loop over table entries
+  } // End building the crc table
+
+  std::uint32_t crc( std::uint32_t c , const std::uint8_t *data , std::size_t len ) {
+    for (std::size_t k=0 ; k<len ; k++) { c = crc_table[(c^data[k])&0xff] ^ (c>>8); }
+    return c;
+  } // End updating a crc
+
+  static void put_u32( std::vector<std::uint8_t> &out , std::uint32_t v ) {
+    out.push_back(v>>24); out.push_back(v>>16); out.push_back(v>>8); out.push_back(v);
+  } // End writing a big endian integer
+
+  void write_chunk( std::ofstream &file , const char *type , const std::vector<std::uint8_t> &data ) {
+    std::vector<std::uint8_t> head;
+    put_u32(head,data.size());
+    head.insert(head.end(),type,type+4);
+    std::uint32_t c = crc(0xffffffffu,head.data()+4,4);
+    c = crc(c,data.data(),data.size()) ^ 0xffffffffu;
+    std::vector<std::uint8_t> tail;
+    put_u32(tail,c);
+    file.write((const char*)head.data(),head.size());
+    file.write((const char*)data.data(),data.size());
+    file.write((const char*)tail.data(),tail.size());
+  } // End writing a png chunk
+
+  void fill_scanline( grid_2d &g , int i , int scale ) {
+    // Pixels for one row of cells, each cell repeated scale times
+    pixels.clear();
+    for (int j=0 ; j<g.cols() ; j++) {
+      auto rgb = cell_color( g.get_cell_type(i,j) );
+      for (int s=0 ; s<scale ; s++) { pixels.insert(pixels.end(),rgb.begin(),rgb.end()); }
+    } // End loop over the columns
+  } // End filling a scanline
+public:
+  image_writer() { build_crc_table(); }
+
+  void write_ppm( grid_2d &g , const std::string &path , int scale=1 ) {
+    std::ofstream file(path,std::ios::binary);
+    if (!file) throw std::runtime_error("Could not open "+path+" for writing.");
+    file << "P6\n" << g.cols()*scale << " " << g.rows()*scale << "\n255\n";
+    for (int i=0 ; i<g.rows() ; i++) {
+      fill_scanline(g,i,scale);
+      for (int s=0 ; s<scale ; s++) { file.write((const char*)pixels.data(),pixels.size()); }
+    } // End loop over the rows
+  } // End writing a ppm image
+
+  void write_png( grid_2d &g , const std::string &path , int scale=1 ) {
+    std::ofstream file(path,std::ios::binary);
+    if (!file) throw std::runtime_error("Could not open "+path+" for writing.");
+    std::uint32_t width = g.cols()*scale , height = g.rows()*scale;
+
+    static const std::uint8_t signature[8] = { 137 , 80 , 78 , 71 , 13 , 10 , 26 , 10 };
+    file.write((const char*)signature,8);
+
+    std::vector<std::uint8_t> header;
+    put_u32(header,width);
+    put_u32(header,height);
+    header.insert(header.end(),{ 8 , 2 , 0 , 0 , 0 }); // 8 bit RGB, no interlace
+    write_chunk(file,"IHDR",header);
+
+    // Raw image is every scanline with a leading 0 (no filter) byte
+    std::vector<std::uint8_t> raw;
+    raw.reserve( (std::size_t)height*(3*width+1) );
+    for (int i=0 ; i<g.rows() ; i++) {
+      fill_scanline(g,i,scale);
+      for (int s=0 ; s<scale ; s++) {
+	raw.push_back(0);
+	raw.insert(raw.end(),pixels.begin(),pixels.end());
+      } // End repeating the scanline
+    } // End loop over the rows
+
+    // zlib stream made of stored deflate blocks, at most 65535 bytes each
+    std::vector<std::uint8_t> idat = { 0x78 , 0x01 };
+    std::uint32_t a = 1 , b = 0;
+    std::size_t pos = 0;
+    do {
+      std::size_t len = std::min<std::size_t>(65535,raw.size()-pos);
+      bool last = ( pos+len == raw.size() );
+      idat.push_back( last ? 1 : 0 );
+      idat.push_back(len&0xff); idat.push_back(len>>8);
+      idat.push_back(~len&0xff); idat.push_back((~len>>8)&0xff);
+      for (std::size_t k=pos ; k<pos+len ; k++) {
+	a = (a+raw[k]) % 65521;
+	b = (b+a) % 65521;
+      } // End updating the adler checksum
+      idat.insert(idat.end(),raw.begin()+pos,raw.begin()+pos+len);
+      pos += len;
+    } while ( pos < raw.size() );
+    put_u32(idat,(b<<16)|a);
+    write_chunk(file,"IDAT",idat);
+    write_chunk(file,"IEND",{});
+  } // End writing a png image
+
+  void write( grid_2d &g , const std::string &path , int scale=1 ) {
+    // Picks the format from the file extension, .png or .ppm
+    auto ends_with = [&]( const char *ext ) { return path.size()>=4 && path.compare(path.size()-4,4,ext)==0; };
+    if ( ends_with(".ppm") ) { write_ppm(g,path,scale); }
+    else if ( ends_with(".png") ) { write_png(g,path,scale); }
+    else throw std::runtime_error("Cannot write "+path+", images are .png or .ppm.");
+  } // End writing an image
+}; // End of image writer class
@@ -0,0 +1,233 @@
+#pragma once // Guard multiple instances
+
+#include "grid.hpp"
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// A ring of frames in POSIX shared memory, for watching a running simulation
+// from another process (ocean_viewer) without ever making the simulation
+// wait. The writer overwrites the oldest of a few slots and never looks at
+// the readers; each slot carries a sequence number that is odd while it is
+// being written (a seqlock), so a reader copies a slot out and keeps it only
+// if the number was even and unchanged across the copy.
+//
+// Layout of the shared memory object:
+//   frame_ring_header, padded to frame_ring_align bytes
+//   slots x slot_bytes, each a frame_slot_header followed by the
+//   view_rows x view_cols cells of the frame (one byte each, the cell_type)
+// A frame is the ocean scaled down to at most max_view cells a side. Each
+// view cell shows the most visible thing in its block (ship, then turtle,
+// then garbage), found from the grid's non-water cells only, so publishing
+// costs the view size plus the number of objects, not the ocean's area.
+
+constexpr std::uint64_t frame_ring_magic = 0x474e495241454f43; // "OCEARING"
+constexpr std::uint32_t frame_ring_version = 1;
+constexpr std::size_t frame_ring_align = 64;
+
+struct frame_ring_header {
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t slots;
+  std::int64_t rows , cols;           // Size of the ocean
+  std::int32_t view_rows , view_cols; // Size of each frame
+  std::uint64_t slot_bytes;
+  std::atomic<std::uint64_t> published; // Frames written so far, frame k is in slot k%slots
+  std::atomic<std::uint32_t> finished;  // Nonzero once the writer is done
+};
+
+struct frame_slot_header {
+  std::atomic<std::uint64_t> seq; // Odd while the writer is in this slot
+  std::uint64_t frame;
+  std::int32_t simulation , timestep;
+  std::int64_t counts[4]; // Cells of each type in the whole ocean
+  double sardines;
+};
+
+struct ring_frame {
+  // A frame copied out of the ring
+  std::uint64_t frame{0};
+  int simulation{0} , timestep{0};
+  std::int64_t counts[4]{};
+  double sardines{0};
+  int rows{0} , cols{0};
+  std::vector<std::uint8_t> cells; // rows x cols, row major
+
+  cell_type at( int i , int j ) const { return static_cast<cell_type>(cells[(std::size_t)i*cols+j]); }
+};
+
+inline std::size_t frame_ring_round( std::size_t bytes ) { return (bytes+frame_ring_align-1)/frame_ring_align*frame_ring_align; }
+
+inline int frame_ring_rank( cell_type t ) {
+  // Which type wins a view cell, higher is drawn on top
+  static constexpr int rank[4] = { 0 , 2 , 3 , 1 }; // water, turtle, ship, garbage
+  return rank[ static_cast<int>(t) ];
+} // End ranking a cell type
+
+class frame_ring_writer {
+private:
+  std::string name;
+  int fd{-1};
+  void *base{nullptr};
+  std::size_t bytes{0};
+  frame_ring_header *head{nullptr};
+  std::int64_t block_rows{1} , block_cols{1}; // Ocean cells per view cell
+
+  frame_slot_header* slot( std::uint64_t k ) {
+    return reinterpret_cast<frame_slot_header*>( static_cast<char*>(base) + frame_ring_round(sizeof(frame_ring_header)) + k*head->slot_bytes );
+  } // End finding a slot
+public:
+  frame_ring_writer( const std::string &name , std::int64_t rows , std::int64_t cols , int max_view = 512 , int slots = 8 ) : name(name) {
+    // Creates (or takes over) the shared memory object called name, e.g. "/ocean"
+    if ( rows <= 0 || cols <= 0 ) throw std::runtime_error("The frame ring needs a nonempty ocean.");
+    block_rows = (rows+max_view-1)/max_view;
+    block_cols = (cols+max_view-1)/max_view;
+    int view_rows = (rows+block_rows-1)/block_rows , view_cols = (cols+block_cols-1)/block_cols;
+    std::size_t slot_bytes = frame_ring_round( sizeof(frame_slot_header) + (std::size_t)view_rows*view_cols );
+    bytes = frame_ring_round(sizeof(frame_ring_header)) + slots*slot_bytes;
+
+    fd = shm_open(name.c_str(),O_CREAT|O_RDWR,0644);
+    if ( fd < 0 ) throw std::runtime_error("Could not open shared memory "+name+": "+std::strerror(errno));
+    if ( ftruncate(fd,0) != 0 || ftruncate(fd,bytes) != 0 ) { // Zeroed, even if a stale ring was left behind
+      close(fd);
+      throw std::runtime_error("Could not size shared memory "+name+": "+std::strerror(errno));
+    }
+    base = mmap(nullptr,bytes,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+    if ( base == MAP_FAILED ) {
+      close(fd);
+      throw std::runtime_error("Could not map shared memory "+name+": "+std::strerror(errno));
+    }
+
+    head = new (base) frame_ring_header{};
+    head->version = frame_ring_version;
+    head->slots = slots;
+    head->rows = rows;
+    head->cols = cols;
+    head->view_rows = view_rows;
+    head->view_cols = view_cols;
+    head->slot_bytes = slot_bytes;
+    for ( int k=0 ; k<slots ; k++ ) { new (slot(k)) frame_slot_header{}; }
+    std::atomic_thread_fence(std::memory_order_release);
+    head->magic = frame_ring_magic; // Readers check this last
+  } // End creating the ring
+
+  frame_ring_writer( const frame_ring_writer& ) = delete;
+  frame_ring_writer& operator = ( const frame_ring_writer& ) = delete;
+
+  ~frame_ring_writer() {
+    // Readers that are attached keep their mapping, new ones can no longer attach
+    head->finished.store(1,std::memory_order_release);
+    munmap(base,bytes);
+    close(fd);
+    shm_unlink(name.c_str());
+  } // End removing the ring
+
+  void publish( int simulation , int timestep , grid_2d &g , double sardines = 0.0 ) {
+    std::uint64_t k = head->published.load(std::memory_order_relaxed);
+    frame_slot_header *s = slot(k%head->slots);
+    std::uint64_t seq = s->seq.load(std::memory_order_relaxed);
+    s->seq.store(seq+1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s->frame = k;
+    s->simulation = simulation;
+    s->timestep = timestep;
+    for ( int t=0 ; t<4 ; t++ ) { s->counts[t] = g.get_num_cell_type(static_cast<cell_type>(t)); }
+    s->sardines = sardines;
+    std::uint8_t *cells = reinterpret_cast<std::uint8_t*>(s+1);
+    std::memset(cells,0,(std::size_t)head->view_rows*head->view_cols);
+    int view_cols = head->view_cols;
+    g.for_each_cell({cell_type::garbage,cell_type::turtle,cell_type::ship},[&](int i, int j, cell_type t) {
+      std::uint8_t &v = cells[(std::size_t)(i/block_rows)*view_cols + j/block_cols];
+      if ( frame_ring_rank(t) > frame_ring_rank(static_cast<cell_type>(v)) ) { v = static_cast<std::uint8_t>(t); }
+    });
+
+    s->seq.store(seq+2,std::memory_order_release);
+    head->published.store(k+1,std::memory_order_release);
+  } // End publishing a frame
+}; // End of frame ring writer class
+
+class frame_ring_reader {
+private:
+  int fd{-1};
+  void *base{nullptr};
+  std::size_t bytes{0};
+  const frame_ring_header *head{nullptr};
+
+  const frame_slot_header* slot( std::uint64_t k ) const {
+    return reinterpret_cast<const frame_slot_header*>( static_cast<const char*>(base) + frame_ring_round(sizeof(frame_ring_header)) + k*head->slot_bytes );
+  } // End finding a slot
+public:
+  explicit frame_ring_reader( const std::string &name ) {
+    // Attaches to the ring a simulation is publishing as name
+    fd = shm_open(name.c_str(),O_RDONLY,0);
+    if ( fd < 0 ) throw std::runtime_error("No simulation is publishing to "+name+" (run it with --live "+name+").");
+    struct stat info;
+    if ( fstat(fd,&info) != 0 || (std::size_t)info.st_size < sizeof(frame_ring_header) ) {
+      close(fd);
+      throw std::runtime_error("Shared memory "+name+" is not a frame ring.");
+    }
+    bytes = info.st_size;
+    base = mmap(nullptr,bytes,PROT_READ,MAP_SHARED,fd,0);
+    if ( base == MAP_FAILED ) {
+      close(fd);
+      throw std::runtime_error("Could not map shared memory "+name+": "+std::strerror(errno));
+    }
+    head = static_cast<const frame_ring_header*>(base);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ( head->magic != frame_ring_magic || head->version != frame_ring_version
+	 || frame_ring_round(sizeof(frame_ring_header)) + head->slots*head->slot_bytes > bytes ) {
+      munmap(base,bytes);
+      close(fd);
+      throw std::runtime_error("Shared memory "+name+" is not a frame ring of this version.");
+    }
+  } // End attaching to the ring
+
+  frame_ring_reader( const frame_ring_reader& ) = delete;
+  frame_ring_reader& operator = ( const frame_ring_reader& ) = delete;
+
+  ~frame_ring_reader() {
+    munmap(base,bytes);
+    close(fd);
+  } // End detaching from the ring
+
+  std::int64_t rows() const { return head->rows; }
+  std::int64_t cols() const { return head->cols; }
+  std::uint64_t published() const { return head->published.load(std::memory_order_acquire); }
+  bool finished() const { return head->finished.load(std::memory_order_acquire) != 0; }
+
+  bool latest( ring_frame &out ) const {
+    // Copies the newest frame into out, false if there is none yet. If the
+    // writer laps the copy it is thrown away and the then newest one is taken.
+    for ( int attempt=0 ; attempt<100 ; attempt++ ) {
+      std::uint64_t k = published();
+      if ( k == 0 ) { return false; }
+      const frame_slot_header *s = slot((k-1)%head->slots);
+      std::uint64_t before = s->seq.load(std::memory_order_acquire);
+      if ( before%2 == 1 ) { continue; } // Writer is in it
+
+      out.frame = s->frame;
+      out.simulation = s->simulation;
+      out.timestep = s->timestep;
+      std::copy(s->counts,s->counts+4,out.counts);
+      out.sardines = s->sardines;
+      out.rows = head->view_rows;
+      out.cols = head->view_cols;
+      out.cells.resize((std::size_t)out.rows*out.cols);
+      std::memcpy(out.cells.data(),reinterpret_cast<const std::uint8_t*>(s+1),out.cells.size());
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if ( s->seq.load(std::memory_order_relaxed) == before && out.frame == k-1 ) { return true; }
+    } // End loop over attempts
+    return false;
+  } // End reading the newest frame
+}; // End of frame ring reader class
@@ -0,0 +1,125 @@
+#pragma once // Guard multiple instances
+
+#include <vector>
+#include <climits>
+#include <cstdint>
+#include <algorithm>
+
+class garbage_distance {
+  // Number of moves (8 connected, so the Chebyshev distance) from every cell to
+  // the nearest garbage. build() is one multi-source breadth first search over
+  // the grid. When a ship picks garbage up, remove_source() only recomputes
+  // the cells whose nearest garbage was that piece, growing them back in from
+  // the cells around them that still have a valid distance.
+private:
+  int m{0} , n{0};
+  std::vector<int> dist;   // Moves to the nearest garbage
+  std::vector<std::int64_t> source; // Index of that garbage, -1 if none
+  std::vector<std::int64_t> queue;  // Scratch for the searches
+  std::vector<std::vector<std::int64_t>> buckets; // Cells to relax, indexed by distance
+
+  static constexpr int delta_i[8] = {1,1,1,0,-1,-1,-1,0};
+  static constexpr int delta_j[8] = {-1,0,1,1,1,0,-1,-1};
+public:
+  static constexpr int far = INT_MAX/2; // Distance when there is no garbage at all
+
+  int at( int i , int j ) { return dist[(std::int64_t)i*n+j]; }
+
+  template <class is_garbage_t>
+  void build( int rows , int cols , is_garbage_t is_garbage ) {
+    // Multi-source breadth first search from every cell where is_garbage(i,j) is true
+    m = rows;
+    n = cols;
+    std::size_t cells = (std::size_t)m*n;
+    dist.assign(cells,far);
+    source.assign(cells,-1);
+    queue.clear();
+    for (int i=0 ; i<m ; i++) {
+      for (int j=0 ; j<n ; j++) {
+	if ( !is_garbage(i,j) ) { continue; }
+	std::int64_t c = (std::int64_t)i*n+j;
+	dist[c] = 0;
+	source[c] = c;
+	queue.push_back(c);
+      } // End loop over columns
+    } // End loop over rows
+    for (std::size_t head=0 ; head<queue.size() ; head++) {
+      std::int64_t c = queue[head];
+      int i = c/n , j = c%n;
+      for (int k=0 ; k<8 ; k++) {
+	int ii = i+delta_i[k] , jj = j+delta_j[k];
+	if ( ii<0 || ii>=m || jj<0 || jj>=n ) { continue; }
+	std::int64_t nb = (std::int64_t)ii*n+jj;
+	if ( dist[nb] != far ) { continue; }
+	dist[nb] = dist[c]+1;
+	source[nb] = source[c];
+	queue.push_back(nb);
+      } // End loop over neighbors
+    } // End breadth first search
+  } // End building the distance field
+
+  void remove_source( int i , int j ) {
+    // Garbage at (i,j) is gone. Distances can only go up, and only for the
+    // cells that were closest to this piece, so those are cleared and then
+    // refilled from their neighbors in order of distance.
+    std::int64_t p = (std::int64_t)i*n+j;
+    if ( source[p] != p ) { return; }
+
+    // Clear every cell that was served by p (they are connected through the search tree)
+    queue.clear();
+    queue.push_back(p);
+    dist[p] = far;
+    source[p] = -1;
+    for (std::size_t head=0 ; head<queue.size() ; head++) {
+      std::int64_t c = queue[head];
+      int ci = c/n , cj = c%n;
+      for (int k=0 ; k<8 ; k++) {
+	int ii = ci+delta_i[k] , jj = cj+delta_j[k];
+	if ( ii<0 || ii>=m || jj<0 || jj>=n ) { continue; }
+	std::int64_t nb = (std::int64_t)ii*n+jj;
+	if ( source[nb] != p ) { continue; }
+	dist[nb] = far;
+	source[nb] = -1;
+	queue.push_back(nb);
+      } // End loop over neighbors
+    } // End clearing the cells of p
+
+    // Seed each cleared cell from its best neighbor that still has a source
+    int lowest = far;
+    for ( std::int64_t c : queue ) {
+      int ci = c/n , cj = c%n;
+      for (int k=0 ; k<8 ; k++) {
+	int ii = ci+delta_i[k] , jj = cj+delta_j[k];
+	if ( ii<0 || ii>=m || jj<0 || jj>=n ) { continue; }
+	std::int64_t nb = (std::int64_t)ii*n+jj;
+	if ( source[nb] < 0 || dist[nb]+1 >= dist[c] ) { continue; }
+	dist[c] = dist[nb]+1;
+	source[c] = source[nb];
+      } // End loop over neighbors
+      if ( source[c] < 0 ) { continue; }
+      if ( dist[c] >= (int)buckets.size() ) { buckets.resize(dist[c]+1); }
+      buckets[dist[c]].push_back(c);
+      lowest = std::min(lowest,dist[c]);
+    } // End seeding the cleared cells
+
+    // Relax outwards in order of distance (unit weights, so buckets work as the priority queue)
+    for (int d=lowest ; d<(int)buckets.size() ; d++) {
+      for (std::size_t b=0 ; b<buckets[d].size() ; b++) {
+	std::int64_t c = buckets[d][b];
+	if ( dist[c] != d ) { continue; } // Already reached with a shorter distance
+	int ci = c/n , cj = c%n;
+	for (int k=0 ; k<8 ; k++) {
+	  int ii = ci+delta_i[k] , jj = cj+delta_j[k];
+	  if ( ii<0 || ii>=m || jj<0 || jj>=n ) { continue; }
+	  std::int64_t nb = (std::int64_t)ii*n+jj;
+	  if ( dist[nb] <= d+1 ) { continue; }
+	  dist[nb] = d+1;
+	  source[nb] = source[c];
+	  if ( d+1 >= (int)buckets.size() ) { buckets.resize(d+2); }
+	  buckets[d+1].push_back(nb);
+	} // End loop over neighbors
+      } // End loop over this distance
+      buckets[d].clear();
+    } // End relaxing the cleared cells
+  } // End removing a piece of garbage
+}; // End of garbage distance class
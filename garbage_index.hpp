@@ -0,0 +1,92 @@
+#pragma once // Guard multiple instances
+
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+
+class garbage_index {
+  // Garbage locations bucketed into a coarse uniform grid of bucket x bucket
+  // cells. Inserting and removing are O(1) (swap with the last entry of the
+  // bucket), and nearest() searches rings of buckets outwards from a cell
+  // until no closer garbage can exist.
+private:
+  int m{0} , n{0};
+  int bucket{16} , bm{0} , bn{0}; // Bucket size and number of bucket rows and columns
+  std::vector<std::vector<std::int64_t>> buckets; // Garbage cells in each bucket
+  std::vector<int> slot; // Position of a cell inside its bucket, -1 when it is not garbage
+  std::int64_t count{0};
+
+  std::int64_t bucket_of( std::int64_t c ) { return ( (c/n)/bucket )*(std::int64_t)bn + (c%n)/bucket; }
+public:
+  garbage_index( int bucket_size = 16 ) : bucket(bucket_size) {};
+
+  std::int64_t size() { return count; }
+
+  bool contains( std::int64_t c ) { return slot[c] >= 0; }
+
+  template <class is_garbage_t>
+  void build( int rows , int cols , is_garbage_t is_garbage ) {
+    m = rows;
+    n = cols;
+    bm = (m+bucket-1)/bucket;
+    bn = (n+bucket-1)/bucket;
+    buckets.assign((std::size_t)bm*bn,{});
+    slot.assign((std::size_t)m*n,-1);
+    count = 0;
+    for (int i=0 ; i<m ; i++) {
+      for (int j=0 ; j<n ; j++) {
+	if ( is_garbage(i,j) ) { insert((std::int64_t)i*n+j); }
+      } // End loop over columns
+    } // End loop over rows
+  } // End building the index
+
+  void insert( std::int64_t c ) {
+    if ( slot[c] >= 0 ) { return; }
+    auto &b = buckets[bucket_of(c)];
+    slot[c] = b.size();
+    b.push_back(c);
+    count++;
+  } // End adding a piece of garbage
+
+  void remove( std::int64_t c ) {
+    if ( slot[c] < 0 ) { return; }
+    auto &b = buckets[bucket_of(c)];
+    std::int64_t last = b.back();
+    b[slot[c]] = last;
+    slot[last] = slot[c];
+    b.pop_back();
+    slot[c] = -1;
+    count--;
+  } // End removing a piece of garbage
+
+  template <class accept_t>
+  std::int64_t nearest( int i , int j , accept_t accept ) {
+    // Closest garbage cell to (i,j) in moves (Chebyshev distance) that accept(c)
+    // allows, or -1 if there is none.
+    std::int64_t best = -1;
+    int best_dist = INT_MAX;
+    int bi = i/bucket , bj = j/bucket;
+    int max_ring = std::max(bm,bn);
+    for (int r=0 ; r<=max_ring ; r++) {
+      // Every cell in ring r is at least (r-1)*bucket+1 moves away
+      if ( r>0 && (r-1)*bucket+1 > best_dist ) { break; }
+      for (int ri=bi-r ; ri<=bi+r ; ri++) {
+	if ( ri<0 || ri>=bm ) { continue; }
+	bool edge_row = ( ri==bi-r || ri==bi+r );
+	for (int rj=bj-r ; rj<=bj+r ; rj += ( edge_row || r==0 ) ? 1 : 2*r) {
+	  if ( rj<0 || rj>=bn ) { continue; }
+	  for ( std::int64_t c : buckets[(std::size_t)ri*bn+rj] ) {
+	    int d = std::max( std::abs((int)(c/n)-i) , std::abs((int)(c%n)-j) );
+	    if ( d < best_dist && accept(c) ) {
+	      best_dist = d;
+	      best = c;
+	    }
+	  } // End loop over garbage in the bucket
+	} // End loop over bucket columns of the ring
+      } // End loop over bucket rows of the ring
+    } // End loop over rings
+    return best;
+  } // End finding the nearest garbage
+}; // End of garbage index class
@@ -4,13 +4,21 @@
 #include <random>
 #include <algorithm>
 #include <utility>
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#include <initializer_list>
 #include "random_gen.cpp"
+#include "rules.hpp"
+#include "cell_storage.hpp"
+#include "count_pyramid.hpp"
+#include "sim_stats.hpp"
+#include "garbage_distance.hpp"
+#include "fleet_planner.hpp"
 using std::pair;
 using std::vector;
 
-// Define our enum class which holds the values a cell may hold
-enum class cell_type { water_only=0 , turtle=1 , ship=2 , garbage=3 };
-
 class cell {
 private:
   // Default cell is open water
@@ -21,71 +29,224 @@ public:
   cell( cell_type t ) : this_cell_type(t) {};
 
   // Overloading
-  bool operator == ( cell_type t ) { return this_cell_type == t; }
+  bool operator == ( cell_type t ) const { return this_cell_type == t; }
 
   void operator = ( cell_type t ) { this_cell_type = t; } // Lets us easily set a cell to a value
 
   // Begin methods
-  cell_type get_cell_type() { return this_cell_type; }
+  cell_type get_cell_type() const { return this_cell_type; }
 
   void set_cell_type( cell_type t ) { this_cell_type = t; }
 
   // Declare friend function so << operator can get private info
   friend std::ostream& operator<<(std::ostream &os, const cell &c);
 }; // End of cell class
+static_assert( sizeof(cell) == 1 , "cells are stored as single bytes" );
+
+// Character used to draw each cell type, indexed by the enum value
+inline char cell_glyph( cell_type t ) {
+  static constexpr char glyphs[4] = { ' ' , 'O' , '|' , 'X' };
+  return glyphs[ static_cast<int>(t) ];
+} // End getting the character for a cell type
 
 // Overload << so we can cout a cell directly
-std::ostream& operator<<(std::ostream &os, const cell &c) {
-  switch (c.this_cell_type) {
-  case cell_type::water_only: os << " "; break;
-  case cell_type::ship:       os << "|"; break;
-  case cell_type::turtle:     os << "O"; break;
-  case cell_type::garbage:    os << "X"; break;
-  } // Done writing correct cell type out to screen
+inline std::ostream& operator<<(std::ostream &os, const cell &c) {
+  os << cell_glyph(c.this_cell_type);
   return os;
 } // End overloading << to cout cells
 
 class grid_2d {
 private:
-  vector<cell> grid_pts; // vector of grid pts, each is a cell
+  cell_storage<cell> grid_pts; // grid pts in 64x64 tiles, each is a cell
+  count_pyramid counts; // Cells of each type per tile and per block of tiles
   int m , n; // m rows and n columns
+  static_assert( count_pyramid::tile_shift == cell_storage<cell>::tile_shift , "pyramid leaves are the storage tiles" );
+
+  void check_bounds( int i , int j ) {
+    if ( i<0 || i>=m || j<0 || j>=n ) throw std::out_of_range("Cell is outside of the grid.");
+  } // End checking a cell is in the grid
+
+  bool tile_is_water( std::int64_t ti , std::int64_t tj ) {
+    return counts.tile_count(ti,tj,static_cast<int>(cell_type::water_only)) == counts.valid_cells(ti,tj);
+  } // End checking if a tile holds only water
+
+  void recount() {
+    // Counts every tile again after a bulk change to the cells, and frees the tiles left empty
+    constexpr int side = cell_storage<cell>::tile_side;
+    for (std::int64_t ti=0 ; ti<grid_pts.tile_rows() ; ti++) {
+      for (std::int64_t tj=0 ; tj<grid_pts.tile_cols() ; tj++) {
+	count_pyramid::counts c{};
+	c[ static_cast<int>(cell_type::water_only) ] = counts.valid_cells(ti,tj);
+	if ( const cell *tile = grid_pts.tile(ti,tj) ) {
+	  c = {};
+	  int rows = std::min<std::int64_t>(side,m-ti*side) , cols = std::min<std::int64_t>(side,n-tj*side);
+	  for (int r=0 ; r<rows ; r++) {
+	    for (int k=0 ; k<cols ; k++) { c[ static_cast<int>(tile[r*side+k].get_cell_type()) ]++; }
+	  } // End loop over rows of the tile
+	} // Done counting an allocated tile
+	counts.set_tile(ti,tj,c);
+	if ( tile_is_water(ti,tj) ) { grid_pts.release(ti,tj); }
+      } // End loop over tile columns
+    } // End loop over tile rows
+    counts.rebuild();
+  } // End recounting the grid
 public:
+  class cell_ref {
+    // What g(i,j) hands back. It reads like a cell, and assigning to it goes
+    // through set_cell_type so the counts follow every change.
+  private:
+    grid_2d &g;
+    int i , j;
+  public:
+    cell_ref( grid_2d &g , int i , int j ) : g(g) , i(i) , j(j) {};
+    cell_ref& operator = ( cell_type t ) { g.set_cell_type(i,j,t); return *this; }
+    bool operator == ( cell_type t ) { return get_cell_type() == t; }
+    cell_type get_cell_type() { return g.get_cell_type(i,j); }
+    void set_cell_type( cell_type t ) { g.set_cell_type(i,j,t); }
+  }; // End of cell reference class
+
   // Constructor
-  grid_2d( int m , int n ) : m(m) , n(n) , grid_pts(m*n) {};
+  grid_2d( int m , int n ) : grid_pts(m,n) , counts(m,n) , m(m) , n(n) {};
 
   // Overloading
-  cell& operator () ( int i , int j ) { return get_cell(i,j); } // Reference so we can modify the grid
+  cell_ref operator () ( int i , int j ) { return cell_ref(*this,i,j); } // Reference so we can modify the grid
   
   // Methods
   void shuffle_grid() {
+    // Fisher-Yates shuffle over the cells in row major order
     auto &generator = engine();
-    std::shuffle(grid_pts.begin(), grid_pts.end(), generator);
+    std::int64_t cells = grid_pts.size();
+    for (std::int64_t k=cells-1 ; k>0 ; k--) {
+      std::int64_t r = generator.below(k+1);
+      std::swap(grid_pts[k],grid_pts[r]);
+    } // End loop over cells
+    recount();
   } // End of shuffle grid
 
-  int get_num_cell_type( const cell_type &ct ) {
-    // Takes a cell type and returns the amount of that cell in the grid
-    int count = 0;
-    for (int i=0 ; i<m ; i++) {
-      for (int j=0 ; j<n ; j++) {
-	if ( ct == get_cell_type(i,j) ) { count++; }
-      } // End loop over columns
-    } // End loop over rows
-    return count;
+  void fill( cell_type t ) {
+    // Sets every cell to t
+    grid_pts.fill(cell(t));
+    counts.fill(static_cast<int>(t));
+  } // End filling the grid
+
+  void copy_type( grid_2d &g , cell_type t ) {
+    // Cells of type t in g stay t here and everything else becomes water, a tile at a time
+    for (std::int64_t ti=0 ; ti<grid_pts.tile_rows() ; ti++) {
+      for (std::int64_t tj=0 ; tj<grid_pts.tile_cols() ; tj++) {
+	count_pyramid::counts c{};
+	c[static_cast<int>(t)] = g.counts.tile_count(ti,tj,static_cast<int>(t));
+	c[static_cast<int>(cell_type::water_only)] += counts.valid_cells(ti,tj) - c[static_cast<int>(t)];
+	counts.set_tile(ti,tj,c);
+	if ( c[static_cast<int>(t)] == 0 || t == cell_type::water_only ) {
+	  grid_pts.release(ti,tj);
+	  continue;
+	} // Nothing of type t here, so the tile is all water
+	const cell *from = g.grid_pts.tile(ti,tj);
+	cell *to = grid_pts.writable_tile(ti,tj);
+	for (int k=0 ; k<cell_storage<cell>::tile_cells ; k++) {
+	  to[k] = from[k] == t ? t : cell_type::water_only;
+	} // End loop over the cells of the tile
+      } // End loop over tile columns
+    } // End loop over tile rows
+    counts.rebuild();
+  } // End copying one type of cell
+
+  std::int64_t tile_count( std::int64_t ti , std::int64_t tj , cell_type ct ) { return counts.tile_count(ti,tj,static_cast<int>(ct)); } // In 64x64 tile (ti,tj)
+
+  std::int64_t allocated_tiles() { return grid_pts.allocated_tiles(); }
+
+  std::int64_t tile_rows() { return grid_pts.tile_rows(); }
+
+  std::int64_t tile_cols() { return grid_pts.tile_cols(); }
+
+  const cell* tile_view( std::int64_t ti , std::int64_t tj ) { return grid_pts.tile_or_water(ti,tj); } // 64x64 cells, row major, read only
+
+  template <class visit_t>
+  void for_each_cell( std::initializer_list<cell_type> types , visit_t visit ) {
+    // Calls visit(i,j,type) for every cell of one of these types, tile by tile,
+    // skipping the tiles that the counts say have none of them
+    constexpr int side = cell_storage<cell>::tile_side;
+    for (std::int64_t ti=0 ; ti<grid_pts.tile_rows() ; ti++) {
+      for (std::int64_t tj=0 ; tj<grid_pts.tile_cols() ; tj++) {
+	std::int64_t here = 0;
+	for ( cell_type t : types ) { here += counts.tile_count(ti,tj,static_cast<int>(t)); }
+	if ( here == 0 ) { continue; }
+	const cell *tile = grid_pts.tile(ti,tj);
+	int rows = std::min<std::int64_t>(side,m-ti*side) , cols = std::min<std::int64_t>(side,n-tj*side);
+	for (int r=0 ; r<rows ; r++) {
+	  for (int c=0 ; c<cols ; c++) {
+	    cell_type t = tile ? tile[r*side+c].get_cell_type() : cell_type::water_only;
+	    if ( std::find(types.begin(),types.end(),t) != types.end() ) { visit((int)(ti*side+r),(int)(tj*side+c),t); }
+	  } // End loop over columns of the tile
+	} // End loop over rows of the tile
+      } // End loop over tile columns
+    } // End loop over tile rows
+  } // End visiting cells of some types
+
+  std::int64_t get_num_cell_type( const cell_type &ct ) {
+    // Takes a cell type and returns the amount of that cell in the grid, kept up to date by the counts
+    return counts.total(static_cast<int>(ct));
   } // End function for counting cells of a certain type
+
+  std::int64_t count_region( cell_type ct , int i0 , int j0 , int i1 , int j1 ) {
+    // Cells of type ct with i0<=i<i1 and j0<=j<j1, whole tiles come straight from
+    // the counts and the tiles cut by the edges are scanned, O(perimeter x 64)
+    return counts.count_region(static_cast<int>(ct),i0,j0,i1,j1,[&](std::int64_t a0, std::int64_t b0, std::int64_t a1, std::int64_t b1) {
+      std::int64_t count = 0;
+      for (std::int64_t i=a0 ; i<a1 ; i++) {
+	for (std::int64_t j=b0 ; j<b1 ; j++) { count += grid_pts.get(i,j) == ct; }
+      } // End loop over rows
+      return count;
+    });
+  } // End counting a region of the grid
+
+  pair<int,int> sample_cell( cell_type ct ) {
+    // Uniformly random cell of type ct, {-1,-1} if there is none.
+    // The counts pick the tile in O(log N), then the tile is searched.
+    std::int64_t total = get_num_cell_type(ct);
+    if ( total == 0 ) { return {-1,-1}; }
+    std::int64_t k = engine().below(total);
+    auto [ti,tj] = counts.find_tile(static_cast<int>(ct),k);
+    constexpr int side = cell_storage<cell>::tile_side;
+    const cell *tile = grid_pts.tile(ti,tj);
+    int rows = std::min<std::int64_t>(side,m-ti*side) , cols = std::min<std::int64_t>(side,n-tj*side);
+    if ( !tile ) { return { (int)(ti*side+k/cols) , (int)(tj*side+k%cols) }; } // All water
+    for (int r=0 ; r<rows ; r++) {
+      for (int c=0 ; c<cols ; c++) {
+	if ( tile[r*side+c] == ct && k-- == 0 ) { return { (int)(ti*side+r) , (int)(tj*side+c) }; }
+      } // End loop over columns of the tile
+    } // End loop over rows of the tile
+    throw std::logic_error("Cell counts do not match the grid.");
+  } // End sampling a cell of one type
   
+  int rows() { return m; }
+
+  int cols() { return n; }
+
+  void append_row( int i , std::string &out ) {
+    // Appends the characters for row i onto out
+    for (int j=0 ; j<n ; j++) {
+      out.push_back( cell_glyph( get_cell_type(i,j) ) );
+    } // End loop over the columns
+  } // End appending a row of the grid
+
   void print_grid() {
-    // Function that prints out the grid
+    // Function that prints out the grid, built in one buffer and written at once
+    std::string frame;
+    frame.reserve( (std::size_t)(m+1)*(n+1) );
     for (int i=0 ; i<m ; i++) {
-      for (int j=0 ; j<n ; j++) {
-	std::cout << get_cell(i,j);
-      } // End loop over the columns
-      std::cout << '\n';
+      append_row(i,frame);
+      frame.push_back('\n');
     } // End loop over the rows
-    for (int i=0 ; i<n ; i++) { std::cout << "-"; }
-    std::cout << '\n';
+    frame.append(n,'-');
+    frame.push_back('\n');
+    std::cout << frame;
   } // End printing out the grid
   
-  cell& get_cell( int i , int j ) { return grid_pts.at( i*n + j ); } // Reference so we can modify the grid
+  const cell& get_cell( int i , int j ) {
+    check_bounds(i,j);
+    return grid_pts.get(i,j);
+  } // Read only, changes go through set_cell_type
 
   bool is_move_valid(pair<int,int> new_ij, cell_type ct, grid_2d &g) {
     // Unpack the variables
@@ -94,45 +255,17 @@ public:
     // First check if in bounds, return false if no
     if ( !(new_i>=0 && new_j>=0 && new_i<m && new_j<n) ) { return false; }
     
-    // Check the old and the new grid
-    cell_type last_destination = get_cell_type(new_i,new_j);
-    cell_type destination = g.get_cell_type(new_i,new_j);
-
-    // Give the options for the current cell types available
-    switch (ct) {
-    case cell_type::water_only :
-      return true; break; // Water can go anywhere, though this isn't really needed, random_motion() should never let a water cell get here.
-    case cell_type::garbage :
-      if ( last_destination == cell_type::garbage || destination == cell_type::garbage ) { return false; break; }
-      else { return true; break; } // Garbage can go anywhere except onto other garbage
-    case cell_type::turtle :
-      if ( last_destination == cell_type::ship || last_destination == cell_type::turtle ||
-	   destination == cell_type::ship || destination == cell_type::turtle ) {
-	return false;
-      } // If current cell is a turtle do not let it move onto another turtle or ship ( prevents overwriting )
-      else { return true; }
-      break;
-    case cell_type::ship :
-      if ( last_destination == cell_type::ship || last_destination == cell_type::turtle ||
-	   destination == cell_type::ship || destination == cell_type::turtle ) {
-	return false;
-      }  // If current cell is a ship do not let it move onto another turtle or ship ( prevents overwriting )
-      else { return true; }
-      break;
-    } // End checking the if move is valid for particular cell_type
+    // The rule table says whether ct may go there given both grids
+    return rule_for(ct,get_cell_type(new_i,new_j),g.get_cell_type(new_i,new_j)).allowed;
   } // End checking if move is valid
 
   pair<int,int> random_cell(int i, int j) {
-    // Call up the engine 
-    auto &generator = engine();
-    std::uniform_int_distribution<int> zero_to_seven(0,7);
-
     // Cell deltas
-    auto delta_i = vector<int> {1,1,1,0,-1,-1,-1,0};
-    auto delta_j = vector<int> {-1,0,1,1,1,0,-1,-1};
+    static constexpr int delta_i[8] = {1,1,1,0,-1,-1,-1,0};
+    static constexpr int delta_j[8] = {-1,0,1,1,1,0,-1,-1};
 
-    // Getting random cell
-    int rand_cell = zero_to_seven(generator);
+    // Getting random cell, three random bits
+    int rand_cell = engine().direction();
 
     // Return the random cell
     return {i+delta_i[rand_cell] , j+delta_j[rand_cell]};
@@ -154,8 +287,11 @@ public:
       is_valid = is_move_valid({new_i,new_j}, ct, g);
       tries_to_move++;
     } // End loop over trying to move
+    STAT_ADD(move_attempts, tries_to_move);
+    STAT_ADD(move_rejections, tries_to_move - (is_valid ? 1 : 0));
 
     if ( !is_valid ) {
+      STAT_ADD(stuck_agents, 1);
       return {i,j}; // Do not move
     } // End checking if we were able to move
     else {
@@ -168,43 +304,93 @@ public:
     auto delta_j = vector<int> {-1,0,1,1,1,0,-1,-1};
 
     for ( auto [ii,jj] : neighbors(i,j) ) {
-      if ( g.get_cell_type(ii,jj) == cell_type::garbage ) { return {ii,jj}; }
+      if ( g.get_cell_type(ii,jj) == cell_type::garbage ) { STAT_ADD(smart_ship_hits, 1); return {ii,jj}; }
       else { continue; }
     } // End loop over the neighbors
 
     // If no trash return random move
     return get_valid_random_move(i,j,cell_type::ship,g);    
   } // End getting smart move for a ship
-  void random_motion(int i, int j, grid_2d &g, bool smart_ships, bool ocean_currents) {
-    cell_type ct = get_cell_type(i, j);
-
-    // Water and garbage do not move
-    if (ct == cell_type::water_only || ct == cell_type::garbage) return;
-
-    if (ct == cell_type::turtle) {
-      auto [new_i, new_j] = get_valid_random_move(i, j, cell_type::turtle, g);
-      cell_type dest = g.get_cell_type(new_i, new_j);
 
-      if (new_i == i && new_j == j) {
-	g(i, j) = cell_type::turtle; // stay in place
-	return;
+  pair<int,int> field_ship_move(int i, int j, grid_2d &g, garbage_distance &field) {
+    // Step to the valid neighbor closest to any garbage in the ocean
+    int best = field.at(i,j);
+    pair<int,int> best_ij = {i,j};
+    for ( auto [ii,jj] : neighbors(i,j) ) {
+      if ( field.at(ii,jj) < best && is_move_valid({ii,jj},cell_type::ship,g) ) {
+	best = field.at(ii,jj);
+	best_ij = {ii,jj};
       }
+    } // End loop over the neighbors
 
-      g(new_i, new_j) = (dest == cell_type::garbage ? cell_type::garbage : cell_type::turtle);
-      g(i, j) = cell_type::water_only;
-    }
-
-    else if (ct == cell_type::ship) {
-      auto [new_i, new_j] = smart_ships ? smart_ship_move(i, j, g)
-	: get_valid_random_move(i, j, cell_type::ship, g);
-      if (new_i == i && new_j == j) {
-	g(i, j) = cell_type::ship; // stay in place
-	return;
+    if ( best_ij.first != i || best_ij.second != j ) {
+      if ( best == 0 ) { STAT_ADD(smart_ship_hits, 1); }
+      return best_ij;
+    } // Done moving downhill
+
+    // No garbage anywhere, or the way is blocked, so move randomly
+    return get_valid_random_move(i,j,cell_type::ship,g);
+  } // End getting a move from the distance field
+
+  pair<int,int> planned_ship_move(int i, int j, grid_2d &g, fleet_planner &planner) {
+    // Step towards the garbage the planner gave this ship
+    std::int64_t target = planner.target_of((std::int64_t)i*n+j);
+    if ( target < 0 ) { return smart_ship_move(i,j,g); } // Nothing left to claim
+
+    int si = (target/n > i) - (target/n < i);
+    int sj = (target%n > j) - (target%n < j);
+
+    // Straight at the target first, then the two directions on either side of it
+    pair<int,int> steps[3] = { {si,sj} , {si,0} , {0,sj} };
+    if ( si == 0 ) { steps[1] = {1,sj}; steps[2] = {-1,sj}; }
+    if ( sj == 0 ) { steps[1] = {si,1}; steps[2] = {si,-1}; }
+    for ( auto [di,dj] : steps ) {
+      if ( di == 0 && dj == 0 ) { continue; }
+      if ( is_move_valid({i+di,j+dj},cell_type::ship,g) ) {
+	if ( g.get_cell_type(i+di,j+dj) == cell_type::garbage ) { STAT_ADD(smart_ship_hits, 1); }
+	return {i+di,j+dj};
       }
+    } // End loop over steps towards the target
 
-      g(new_i, new_j) = cell_type::ship; // ship moves
-      g(i, j) = cell_type::water_only;
+    // Blocked, so move randomly
+    return get_valid_random_move(i,j,cell_type::ship,g);
+  } // End getting a move from the fleet planner
+  void random_motion(int i, int j, grid_2d &g, bool smart_ships, bool ocean_currents, garbage_distance *field = nullptr,
+		     fleet_planner *planner = nullptr) {
+    cell_type ct = get_cell_type(i, j);
+
+    // Water and garbage do not move
+    if ( moves_itself(ct) ) { move_agent(i, j, ct, g, smart_ships, field, planner); }
+  }
+
+  void move_agent(int i, int j, cell_type ct, grid_2d &g, bool smart_ships, garbage_distance *field, fleet_planner *planner) {
+    // Moves the ship or turtle at (i,j) of this grid into g
+    auto [new_i, new_j] = ct != cell_type::ship ? get_valid_random_move(i, j, ct, g)
+      : planner ? planned_ship_move(i, j, g, *planner)
+      : !smart_ships ? get_valid_random_move(i, j, cell_type::ship, g)
+      : field ? field_ship_move(i, j, g, *field) : smart_ship_move(i, j, g);
+    if (new_i == i && new_j == j) {
+      g(i, j) = ct; // stay in place
+      return;
     }
+
+    // The move was checked against the rules, so they also say what it does
+    const move_rule &rule = rule_for(ct, get_cell_type(new_i, new_j), g.get_cell_type(new_i, new_j));
+    switch (rule.event) {
+    case move_event::none :
+      break;
+    case move_event::turtle_dies :
+      STAT_ADD(turtle_deaths, 1);
+      break;
+    case move_event::garbage_picked_up :
+      STAT_ADD(garbage_pickups, 1);
+      if (field) { field->remove_source(new_i, new_j); }
+      if (planner) { planner->garbage_removed((std::int64_t)new_i*n + new_j); }
+      break;
+    } // End handling the event
+    if (planner && ct == cell_type::ship) { planner->ship_moved((std::int64_t)i*n + j, (std::int64_t)new_i*n + new_j); }
+    g(new_i, new_j) = rule.result;
+    g(i, j) = cell_type::water_only;
   } /*
   void random_motion( int i , int j , grid_2d &g , bool smart_ships , bool ocean_currents ) {
     // Takes indicies of a grid, determines what is at that grid point.
@@ -295,7 +481,17 @@ public:
     return count;
   } // End counting the type of objects around a certain cell
   
-  cell_type get_cell_type( int i , int j ) { return grid_pts.at( i*n + j ).get_cell_type(); }
+  cell_type get_cell_type( int i , int j ) { return get_cell(i,j).get_cell_type(); }
   
-  void set_cell_type( int i , int j , cell_type t ) { grid_pts.at( i*n + j ).set_cell_type(t); }
+  void set_cell_type( int i , int j , cell_type t ) {
+    check_bounds(i,j);
+    cell_type old = grid_pts.get(i,j).get_cell_type();
+    if ( old == t ) { return; } // Also keeps water written to water from allocating a tile
+    counts.change(i,j,static_cast<int>(old),static_cast<int>(t));
+    grid_pts(i,j).set_cell_type(t);
+    if ( t == cell_type::water_only ) {
+      std::int64_t ti = i>>cell_storage<cell>::tile_shift , tj = j>>cell_storage<cell>::tile_shift;
+      if ( tile_is_water(ti,tj) ) { grid_pts.release(ti,tj); }
+    } // Last thing in its tile moved out
+  } // End setting a cell and its counts
 }; // End defining 2d grid class
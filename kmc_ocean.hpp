@@ -0,0 +1,106 @@
+#pragma once // Guard multiple instances
+
+#include "ocean.hpp"
+#include <cmath>
+#include <random>
+
+class kmc_ocean : public ocean {
+  // The same ocean simulated in continuous time, one event at a time
+  // (rejection free kinetic Monte Carlo, the Gillespie algorithm), instead of
+  // sweeping every ship and turtle once per timestep.
+  //
+  // Rates, with one unit of time equal to one timestep of the sweep:
+  //   - every ship and turtle tries a move at rate 1, so on average once per
+  //     unit like in the sweep, using the same random_motion rules (a turtle
+  //     moving onto garbage dies, a ship moving onto it picks it up)
+  //   - every turtle gives birth at rate ln(turtle_rate)/turtle_steps, with
+  //     the baby placed on a random open cell like reproduce_turtles. Over
+  //     turtle_steps units that multiplies the turtles by turtle_rate on
+  //     average, the same growth the sweep applies all at once. A
+  //     turtle_rate of 1 or less means no births, as in the sweep.
+  // The next event comes after an exponential wait with the total rate, and
+  // is a move with probability (ships+turtles)/total, otherwise a birth.
+  // The mover is a uniformly random ship or turtle, drawn from the grid's
+  // count pyramid, so each event is O(log N) and the cost follows the number
+  // of agents rather than the area of the ocean.
+  //
+  // The things that are not agent events still happen at whole units:
+  // garbage drifts with the currents, the distance field and fleet plan are
+  // rebuilt, the sardines update every turtle_steps units, and frame t
+  // (and on_step(t)) comes once the clock passes t+1.
+  // Because moves are asynchronous an agent sees the others where they are
+  // now, not where they were at the start of the step, so results agree with
+  // the sweep in distribution only as far as that difference allows.
+private:
+  double clock{0.0}; // Continuous time simulated so far
+
+  void drift_garbage() {
+    // Garbage moves with the currents once per unit, ships and turtles stay put
+    if ( currents.empty() ) { currents = current_field::gyre(n_rows,n_cols,0.5f); }
+    current_grid.fill(cell_type::water_only);
+    currents.advect(last_grid,current_grid,n_steps);
+    last_grid.for_each_cell({cell_type::ship,cell_type::turtle},[&](int i, int j, cell_type t) { current_grid(i,j) = t; });
+    std::swap(last_grid,current_grid);
+  } // End drifting the garbage
+public:
+  kmc_ocean( int n_rows , int n_cols , int n_sardines ) : ocean(n_rows,n_cols,n_sardines) {};
+
+  double time() { return clock; }
+
+  void reset( int n_sardines ) override {
+    ocean::reset(n_sardines);
+    clock = 0.0;
+  } // End resetting the ocean
+
+  void run_events( double until , double birth_rate , bool smart_ships , bool ocean_currents ,
+		   garbage_distance *field , fleet_planner *fleet ) {
+    // Runs events until the clock reaches until. The wait that crosses until
+    // is thrown away, which is exact because exponential waits have no memory.
+    auto &generator = engine();
+    while ( true ) {
+      std::int64_t ships = last_grid.get_num_cell_type(cell_type::ship);
+      std::int64_t turtles = last_grid.get_num_cell_type(cell_type::turtle);
+      double move_rate = ships+turtles;
+      double total_rate = move_rate + birth_rate*turtles;
+      if ( total_rate <= 0 ) { clock = until; return; } // Nothing can happen
+      clock += generator.exponential(total_rate);
+      if ( clock >= until ) { clock = until; return; }
+
+      if ( generator.uniform()*total_rate < move_rate ) {
+	cell_type who = generator.uniform()*move_rate < ships ? cell_type::ship : cell_type::turtle;
+	auto [i,j] = last_grid.sample_cell(who);
+	last_grid.random_motion(i,j,last_grid,smart_ships,ocean_currents,field,fleet); // One grid, moves happen in place
+      } // Move a ship or turtle
+      else if ( place_randomly(cell_type::turtle) ) {
+	STAT_ADD(turtle_births, 1);
+      } // New turtle
+    } // End loop over events
+  } // End running events
+
+  void advance( int t , double turtle_rate , int turtle_steps , bool smart_ships , bool ocean_currents , bool track_sardines , double sardine_birth_rate , double sardine_eaten_rate ) override {
+    // Unit of time t, ending when the clock passes t+1
+    TRACE_SCOPE("advance_kmc");
+    double birth_rate = ( turtle_rate > 1.0 && turtle_steps > 0 ) ? std::log(turtle_rate)/turtle_steps : 0.0;
+    if ( ocean_currents ) {
+      phase_timer timer(sim_phase::garbage_copy);
+      perf_scope perf(sim_phase::garbage_copy);
+      TRACE_SCOPE("garbage_copy");
+      drift_garbage();
+    } // Done drifting the garbage
+
+    auto [field,fleet] = prepare_navigation(smart_ships,ocean_currents,last_grid);
+    {
+      phase_timer timer(sim_phase::motion_sweep);
+      perf_scope perf(sim_phase::motion_sweep);
+      TRACE_SCOPE("kmc_events");
+      run_events(t+1,birth_rate,smart_ships,ocean_currents,field,fleet);
+    } // Done with this unit of time
+    n_steps++;
+
+    if ( track_sardines && t%turtle_steps == 0 ) {
+      phase_timer timer(sim_phase::reproduction);
+      perf_scope perf(sim_phase::reproduction);
+      eat_and_reproduce_sardines(sardine_birth_rate, sardine_eaten_rate);
+    } // Done reproducing sardines
+  } // End one unit of time
+}; // End defining the kinetic Monte Carlo ocean class
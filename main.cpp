@@ -4,29 +4,86 @@
 #include <ranges>
 #include <cmath>
 #include <tuple>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <typeinfo>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
 #include "ocean.hpp"
+#include "kmc_ocean.hpp"
+#include "meanfield.hpp"
+#include "result_cache.hpp"
+#include "frame_renderer.hpp"
+#include "frame_ring.hpp"
+#include "thread_placement.hpp"
 #include "cxxopts.hpp"
 
-double compute_mean( const std::vector<int> &v ) {
+double compute_mean( const std::vector<std::int64_t> &v ) {
   if (v.size()==1) { return v[0]; }
   auto sum = std::ranges::fold_left(v,0.0,std::plus<>());
   double mean = sum/v.size();
   return mean;
 }
 
-double compute_std( std::vector<int> v ) {
+double compute_std( const std::vector<std::int64_t> &v ) {
   if (v.size()==1) { return 0.0; }
   auto mean = compute_mean(v);
-  std::transform(v.begin(),v.end(),v.begin(),
-		 [&](int &n) {
-		   double diff = n-mean;
-		   return diff*diff;
-		 });
-  auto sum = std::ranges::fold_left(v,0.0,std::plus<>());
+  // Square the deviations as doubles, the counts can be too big to square
+  auto sum = std::ranges::fold_left(v,0.0,
+				    [&](double acc , std::int64_t n) {
+				      double diff = n-mean;
+				      return acc+diff*diff;
+				    });
   double std = std::sqrt( sum/(v.size()-1) );
   return std;
 }
 
+struct ensemble_summary {
+  // Mean and standard deviation of what is left at the end of the simulations
+  int n_sims , timesteps;
+  double turtle_mean , turtle_std;
+  double ship_mean , ship_std;
+  double garbage_mean , garbage_std;
+  double sardine_mean , sardine_std;
+};
+
+void print_summary( const ensemble_summary &s , bool track_sardines ) {
+  // Tell the user the results
+  std::cout << "After " << s.n_sims << " simulations, with " << s.timesteps << " timesteps each, theresults are in:" << '\n';
+  std::cout << "Listed below is the mean and standard deviation of items left in the ocean at the end of each simulation." << '\n';
+  std::cout << "Mean turtles: " << s.turtle_mean << '\n';
+  std::cout << "Standard deviation of turtles: " << s.turtle_std << '\n';
+  std::cout << "Mean ships: " << s.ship_mean << '\n';
+  std::cout << "Standard deviation of ships: " << s.ship_std << '\n';
+  std::cout << "Mean garbage: " << s.garbage_mean << '\n';
+  std::cout << "Standard deviation of garbage: " << s.garbage_std << '\n';
+  if ( track_sardines == true ) {
+    std::cout << "Mean sardines: " << s.sardine_mean << '\n';
+    std::cout << "Standard deviation of sardines: " << s.sardine_std << '\n';
+  } // End displaying sardines if asked for
+} // End printing the summary
+
+void print_extremes( const std::vector<std::pair<std::string,const std::vector<std::int64_t>*>> &outcomes , std::uint64_t master_seed ) {
+  // Which simulations ended with the fewest and most of each thing, and their seeds
+  for ( auto &[what,v] : outcomes ) {
+    if ( v->empty() ) { continue; }
+    auto [low,high] = std::ranges::minmax_element(*v);
+    for ( auto [label,it] : { std::pair{"Fewest ",low} , std::pair{"Most ",high} } ) {
+      std::int64_t index = it-v->begin();
+      std::cout << label << what << ": " << *it << " in simulation " << index
+		<< " (seed " << simulation_seed(master_seed,index) << ")" << '\n';
+    } // End loop over the two ends
+  } // End loop over outcomes
+  std::cout << "Replay one with --seed " << master_seed << " --replay <simulation>" << '\n';
+} // End printing the extreme outcomes
+
 int main( int argc, char ** argv ) {
   // Define the options for the user to input
   cxxopts::Options options
@@ -54,6 +111,21 @@ int main( int argc, char ** argv ) {
   options.add_options()
     ("N,n_simulations","<int> number of simulations to be executed.",
      cxxopts::value<int>()->default_value("10000"));
+  options.add_options()
+    ("seed","<uint64> master seed, simulation i is seeded from it and i so every run is repeatable. Random (and printed) if not given.",
+     cxxopts::value<std::uint64_t>());
+  options.add_options()
+    ("replay","<int> rerun only this simulation of the ensemble (with the same --seed and options), printing every timestep.",
+     cxxopts::value<int>()->default_value("-1"));
+  options.add_options()
+    ("cache","<string> directory of saved ensemble results. Reuses the simulations already run with the same options and seed (0 if --seed is not given) and only runs the extra ones.",
+     cxxopts::value<std::string>()->default_value(""));
+  options.add_options()
+    ("threads","<int> worker threads for the ensemble, 0 for one per cpu. Results do not depend on it.",
+     cxxopts::value<int>()->default_value("1"));
+  options.add_options()
+    ("affinity","<string> pin the workers: none, compact (cpus in order), scatter (spread over NUMA nodes) or a cpu list like 0,2,4-7.",
+     cxxopts::value<std::string>()->default_value("none"));
   options.add_options()
     ("p,printout","<bool> 1 if you want to print out ocean before and after, 0 otherwise.",
      cxxopts::value<bool>()->default_value("1"));
@@ -61,12 +133,56 @@ int main( int argc, char ** argv ) {
     ("i,intelligent_boats","<bool> -i if you want ships to move to grab trash if it is in an adjacent cell, 0 if you want random ship motion.",
      cxxopts::value<bool>()->default_value("0"));
   options.add_options()
-    ("o,ocean_currents","<bool> -o if you want trash to randomly move (like there are ocean currents), 0 if you want them in place.",
+    ("distance_field","<bool> --distance_field to have intelligent boats head for the nearest garbage anywhere in the ocean, not just in adjacent cells.",
+     cxxopts::value<bool>()->default_value("0"));
+  options.add_options()
+    ("fleet-planner","<int> K, give every ship its own garbage target with a greedy auction every K timesteps (0 for off). With -o the garbage drifts, so the auction runs every timestep whatever K is.",
+     cxxopts::value<int>()->default_value("0"));
+  options.add_options()
+    ("model","<string> sweep to move every ship and turtle once per timestep, kmc for continuous time events (see kmc_ocean.hpp for how the rates match), meanfield for an instant estimate from population equations (meanfield.hpp).",
+     cxxopts::value<std::string>()->default_value("sweep"));
+  options.add_options()
+    ("o,ocean_currents","<bool> -o if you want trash to drift with ocean currents, 0 if you want them in place.",
      cxxopts::value<bool>()->default_value("0"));
+  options.add_options()
+    ("current_field","<string> water velocity in cells per timestep used with -o: uniform:<v_row>,<v_col>, gyre:<speed> or file:<path>.",
+     cxxopts::value<std::string>()->default_value("gyre:0.5"));
   options.add_options()("ts,track_sardines","<bool> -ts if you want to track the sardine population",
 			cxxopts::value<bool>()->default_value("0"));
   options.add_options()("sp,sardine_params","<double,double,double>, initial sardine population, rate at which sardines reproduce, how many sardines a turtle eats when the reproduction step is called.",
 			cxxopts::value<vector<double>>()->default_value("100,1,0"));
+  options.add_options()("sf,sardine_field","<double,int,double> sardine diffusion coefficient, stencil (5 or 9 points), and carrying capacity per cell (0 for no limit).",
+			cxxopts::value<vector<double>>()->default_value("0.1,5,0"));
+  options.add_options()
+    ("a,animate","<bool> -a to redraw the ocean in place after every timestep (first simulation only).",
+     cxxopts::value<bool>()->default_value("0"));
+  options.add_options()
+    ("frame_delay","<int> milliseconds to wait between animation frames.",
+     cxxopts::value<int>()->default_value("50"));
+  options.add_options()
+    ("frames","<string> file prefix for image frames of the first simulation, e.g. out/ocean. Empty for no images.",
+     cxxopts::value<std::string>()->default_value(""));
+  options.add_options()
+    ("frame_params","<string,int,int> image format (png or ppm), write an image every N timesteps, pixels per cell.",
+     cxxopts::value<std::vector<std::string>>()->default_value("png,10,1"));
+  options.add_options()
+    ("live","<string> publish frames to a shared memory ring with this name (e.g. /ocean) for ocean_viewer to watch, without slowing the simulation down.",
+     cxxopts::value<std::string>()->default_value(""));
+  options.add_options()
+    ("live_every","<int> publish every N timesteps with --live.",
+     cxxopts::value<int>()->default_value("1"));
+  options.add_options()
+    ("huge_pages","<bool> --huge_pages to back the grid with transparent huge pages (Linux, big oceans).",
+     cxxopts::value<bool>()->default_value("0"));
+  options.add_options()
+    ("stats","<string> write event counters and phase timers as JSON to this file (stdout if no file is given).",
+     cxxopts::value<std::string>()->implicit_value("-"));
+  options.add_options()
+    ("perf","<bool> --perf to count cycles, instructions, cache misses and branch misses per phase with perf_event_open.",
+     cxxopts::value<bool>()->default_value("0"));
+  options.add_options()
+    ("trace","<string> write a Chrome trace / Perfetto timeline of the simulation phases to this file.",
+     cxxopts::value<std::string>()->default_value(""));
 					 
   // Parse the input
   auto result = options.parse(argc,argv);
@@ -88,11 +204,24 @@ int main( int argc, char ** argv ) {
   int n_sims 		= 10000;
   bool printgrid = true;
   bool smart_ships = false;
+  bool distance_field = false;
+  int fleet_planner_every = 0;
+  std::string model = "sweep";
   bool ocean_currents = false;
+  std::string current_spec = "gyre:0.5";
   bool track_sardines = false;
   double init_sardine_pop = 100.0;
   double sardine_birth_rate = 1.0;
   double sardine_eaten_rate = 0.0;
+  double sardine_diffusion = 0.1;
+  int sardine_stencil = 5;
+  double sardine_capacity = 0.0;
+  bool animate = false;
+  int frame_delay = 50;
+  std::string frame_prefix = "";
+  std::string frame_format = "png";
+  int frame_every = 10;
+  int frame_scale = 1;
 	
   // Get users inputs
   std::vector<int> v = result["size"].as<std::vector<int>>();
@@ -111,9 +240,17 @@ int main( int argc, char ** argv ) {
   int turtle_tsteps = reproduction_tsteps;
   timesteps = result["timesteps"].as<int>();
   n_sims = result["n_simulations"].as<int>();
+  int n_threads = result["threads"].as<int>();
+  if ( n_threads <= 0 ) { n_threads = allowed_cpus().size(); }
+  std::string affinity = result["affinity"].as<std::string>();
   printgrid = result["printout"].as<bool>();
   smart_ships = result["intelligent_boats"].as<bool>();
+  distance_field = result["distance_field"].as<bool>();
+  fleet_planner_every = result["fleet-planner"].as<int>();
+  model = result["model"].as<std::string>();
+  if ( model != "sweep" && model != "kmc" && model != "meanfield" ) throw std::runtime_error("Unknown model "+model+", use sweep, kmc or meanfield.");
   ocean_currents = result["ocean_currents"].as<bool>();
+  current_spec = result["current_field"].as<std::string>();
   track_sardines = result["track_sardines"].as<bool>();
   std::vector<double> v3 = result["sardine_params"].as<std::vector<double>>();
   if ( v3.size()==3 ) {
@@ -121,57 +258,292 @@ int main( int argc, char ** argv ) {
     sardine_birth_rate = v3[1];
     sardine_eaten_rate = v3[2];
   }
+  std::vector<double> v5 = result["sardine_field"].as<std::vector<double>>();
+  if ( v5.size()==3 ) {
+    sardine_diffusion = v5[0];
+    sardine_stencil = v5[1];
+    sardine_capacity = v5[2];
+  }
+
+  animate = result["animate"].as<bool>();
+  frame_delay = result["frame_delay"].as<int>();
+  frame_prefix = result["frames"].as<std::string>();
+  std::vector<std::string> v4 = result["frame_params"].as<std::vector<std::string>>();
+  if ( v4.size()==3 ) {
+    frame_format = v4[0];
+    if ( frame_format != "png" && frame_format != "ppm" ) throw std::runtime_error("Unknown --frame_params format "+frame_format+", use png or ppm.");
+    try {
+      frame_every = std::max(1,std::stoi(v4[1]));
+      frame_scale = std::max(1,std::stoi(v4[2]));
+    } catch ( const std::logic_error& ) { throw std::runtime_error("--frame_params needs whole numbers for N and the scale, e.g. png,10,4."); }
+  }
+
+  std::string trace_path = result["trace"].as<std::string>();
+  if ( !trace_path.empty() ) { start_tracing(); }
+  if ( result["perf"].as<bool>() ) { start_perf_counters(); }
+  cell_storage<cell>::huge_pages = result["huge_pages"].as<bool>();
+  std::string live_name = result["live"].as<std::string>();
+  int live_every = std::max(1,result["live_every"].as<int>());
 
   int sardine_pop = std::round(init_sardine_pop);
+
+  // Every simulation is seeded from the master seed and its index, so any one
+  // of them can be replayed. A cache without a seed uses master seed 0.
+  std::string cache_dir = result["cache"].as<std::string>();
+  int replay = result["replay"].as<int>();
+  if ( replay >= 0 && !result.count("seed") && cache_dir.empty() ) throw std::runtime_error("--replay needs the --seed the ensemble was run with.");
+  std::uint64_t master_seed = 0;
+  if ( result.count("seed") ) { master_seed = result["seed"].as<std::uint64_t>(); }
+  else if ( cache_dir.empty() ) { master_seed = ((std::uint64_t)std::random_device{}() << 32) | std::random_device{}(); }
+
+  if ( model == "meanfield" ) {
+    // One deterministic run of the population equations stands in for the ensemble
+    meanfield_model mf;
+    mf.n_cells = (std::int64_t)n_rows*n_cols;
+    mf.turtle_rate = turtle_rate;
+    mf.turtle_steps = turtle_tsteps;
+    mf.smart_ships = smart_ships || fleet_planner_every > 0; // The fleet planner steers ships with or without -i
+    mf.steered_ships = fleet_planner_every > 0 || ( smart_ships && distance_field );
+    mf.track_sardines = track_sardines;
+    mf.sardine_birth_rate = sardine_birth_rate;
+    mf.sardine_eaten_rate = sardine_eaten_rate;
+    mf.sardine_capacity = sardine_capacity;
+    meanfield_state end = mf.run({(double)n_turtles,(double)n_ships,(double)n_garbage,(double)sardine_pop},timesteps);
+    print_summary({1,timesteps,end.turtles,0.0,end.ships,0.0,end.garbage,0.0,end.sardines,0.0},track_sardines);
+    return 0;
+  } // Done with the mean field estimate
   
   // Init vectors to hold how many turtles, ships, and garbage are left at the end
-  std::vector<int> end_turtles(n_sims);
-  std::vector<int> end_ships(n_sims);
-  std::vector<int> end_garbage(n_sims);
-  std::vector<int> end_sardines(n_sims);
-
-  // Loop over and run the simulation n_sims times
-  for ( int i=0 ; i<n_sims ; i++ ) {
-    ocean test_ocean(n_rows,n_cols,sardine_pop);
+  std::vector<std::int64_t> end_turtles(n_sims);
+  std::vector<std::int64_t> end_ships(n_sims);
+  std::vector<std::int64_t> end_garbage(n_sims);
+  std::vector<std::int64_t> end_sardines(n_sims);
+
+  // Everything that changes what a simulation does, one option per line
+  std::ostringstream key;
+  key << "engine_version=" << engine_version << '\n'
+      << "engine=" << "xoshiro256++" << '\n'
+      << "seed=" << master_seed << '\n'
+      << "model=" << model << '\n'
+      << "size=" << n_rows << ',' << n_cols << '\n'
+      << "turtles=" << n_turtles << '\n'
+      << "boats=" << n_ships << '\n'
+      << "garbage=" << n_garbage << '\n'
+      << std::setprecision(17)
+      << "turtle_rate=" << turtle_rate << ',' << turtle_tsteps << '\n'
+      << "timesteps=" << timesteps << '\n'
+      << "intelligent_boats=" << smart_ships << '\n'
+      << "distance_field=" << distance_field << '\n'
+      << "fleet_planner=" << fleet_planner_every << '\n'
+      << "ocean_currents=" << ocean_currents << '\n';
+  if ( ocean_currents ) {
+    key << "current_field=" << current_spec << '\n';
+    if ( current_spec.rfind("file:",0) == 0 ) {
+      std::ifstream field_file(current_spec.substr(5));
+      std::stringstream contents;
+      contents << field_file.rdbuf();
+      key << "current_file_hash=" << result_cache::fnv1a(contents.str()) << '\n';
+    } // Files can change under the same name
+  }
+  key << "track_sardines=" << track_sardines << '\n'
+      << "sardine_params=" << sardine_pop << ',' << sardine_birth_rate << ',' << sardine_eaten_rate << '\n'
+      << "sardine_field=" << sardine_diffusion << ',' << sardine_stencil << ',' << sardine_capacity << '\n';
+
+  // Reuse whatever part of the ensemble is already in the cache
+  result_cache cache(cache_dir.empty() ? "." : cache_dir);
+  std::vector<sim_outcome> outcomes;
+  bool replaying = replay >= 0;
+  if ( !cache_dir.empty() && !replaying ) { outcomes = cache.load(key.str()); }
+  int first_sim = std::min<int>(outcomes.size(),n_sims);
+  for ( int i=0 ; i<first_sim ; i++ ) {
+    end_turtles[i] = outcomes[i].turtles;
+    end_ships[i] = outcomes[i].ships;
+    end_garbage[i] = outcomes[i].garbage;
+    end_sardines[i] = outcomes[i].sardines;
+  } // End loop over cached simulations
+  if ( !cache_dir.empty() && !replaying ) {
+    std::cerr << "Result cache: reusing " << first_sim << " of " << n_sims << " simulations from " << cache.path_for(key.str()).string() << '\n';
+  }
+
+  // Build the current field once, every simulation shares it
+  current_field currents;
+  if ( ocean_currents ) { currents = current_field::parse(n_rows,n_cols,current_spec); }
+
+  // Frames for ocean_viewer, from every simulation in turn
+  std::unique_ptr<frame_ring_writer> live;
+  if ( !live_name.empty() ) { live = std::make_unique<frame_ring_writer>(live_name,n_rows,n_cols); }
+
+  // Runs simulation i in the given ocean, the same whichever thread runs it
+  // since it is seeded from i. Each worker keeps its ocean and resets it for
+  // the next simulation, instead of building and freeing one every time.
+  int watched = replaying ? replay : 0;
+  std::mutex output_lock , live_lock;
+  // The animation redraws rows in place, so other simulations hold their
+  // grids until it is over instead of printing into the middle of it
+  std::condition_variable animation_over;
+  bool animating = animate && !replaying && first_sim <= watched;
+  auto end_animation = [&] {
+    { std::lock_guard<std::mutex> guard(output_lock); animating = false; }
+    animation_over.notify_all();
+  };
+  auto print_grid = [&]( int i , ocean &o ) {
+    std::unique_lock<std::mutex> guard(output_lock);
+    if ( i != watched ) { animation_over.wait(guard,[&]{ return !animating; }); }
+    o.print_grid();
+  };
+  if ( !cache_dir.empty() && !replaying ) { outcomes.resize(std::max<std::size_t>(outcomes.size(),n_sims)); }
+  auto run_simulation = [&]( int i , std::unique_ptr<ocean> &simulation ) {
+    seed_engine(simulation_seed(master_seed,i));
+    if ( simulation ) { simulation->reset(sardine_pop); }
+    else {
+      if ( model == "kmc" ) { simulation = std::make_unique<kmc_ocean>(n_rows,n_cols,sardine_pop); }
+      else { simulation = std::make_unique<ocean>(n_rows,n_cols,sardine_pop); }
+      if ( ocean_currents ) { simulation->set_currents(currents); }
+      simulation->set_distance_navigation(distance_field);
+      simulation->set_fleet_planner(fleet_planner_every);
+      simulation->set_sardine_model(sardine_diffusion,sardine_stencil,sardine_capacity);
+    } // Done getting an empty ocean
+    ocean &test_ocean = *simulation;
     test_ocean.initiate_grid(n_ships,n_turtles,n_garbage);
-    if (printgrid) { test_ocean.print_grid(); }
+    if (printgrid && !(animate && i==watched)) { print_grid(i,test_ocean); }
+
+    // Only the first (or replayed) simulation is animated or written out as images, all are published live
+    frame_renderer renderer;
+    image_writer images;
+    auto on_step = [&](int t) {
+      grid_2d &g = test_ocean.get_grid();
+      if ( live && (t+1)%live_every == 0 ) {
+	std::unique_lock<std::mutex> guard(live_lock,std::try_to_lock);
+	if ( guard ) { live->publish(i,t+1,g,track_sardines ? test_ocean.get_sardines().total() : 0.0); }
+      } // Done publishing the frame, skipped if another thread is publishing
+      if ( i != watched ) { return; }
+      if ( replaying && !animate ) {
+	std::cout << "timestep " << t+1 << "/" << timesteps << "  turtles " << g.get_num_cell_type(cell_type::turtle)
+		  << "  ships " << g.get_num_cell_type(cell_type::ship) << "  garbage " << g.get_num_cell_type(cell_type::garbage) << '\n';
+	if ( printgrid ) { test_ocean.print_grid(); }
+      } // Done printing the frame
+      if ( animate ) {
+	renderer.draw(g, "timestep " + std::to_string(t+1) + "/" + std::to_string(timesteps) +
+		      "  turtles " + std::to_string(g.get_num_cell_type(cell_type::turtle)) +
+		      "  ships " + std::to_string(g.get_num_cell_type(cell_type::ship)) +
+		      "  garbage " + std::to_string(g.get_num_cell_type(cell_type::garbage)));
+	std::this_thread::sleep_for(std::chrono::milliseconds(frame_delay));
+      } // Done drawing the frame
+      if ( !frame_prefix.empty() && (t+1)%frame_every == 0 ) {
+	std::string step = std::to_string(t+1);
+	images.write(g, frame_prefix + "_" + std::string(6-std::min<size_t>(6,step.size()),'0') + step + "." + frame_format, frame_scale);
+      } // Done writing the image
+    };
+    bool watch = ( i==watched && ( animate || !frame_prefix.empty() || replaying ) ) || live;
     test_ocean.simulate(timesteps, turtle_rate, reproduction_tsteps, smart_ships, ocean_currents,
-			track_sardines, sardine_birth_rate, sardine_eaten_rate);
-    if (printgrid) { test_ocean.print_grid(); }
+			track_sardines, sardine_birth_rate, sardine_eaten_rate,
+			watch ? std::function<void(int)>(on_step) : std::function<void(int)>());
+    renderer.finish();
+    if ( animate && i == watched ) { end_animation(); }
+    if (printgrid && !(animate && i==watched) && !replaying) { print_grid(i,test_ocean); }
+
+    if ( replaying ) {
+      std::cout << "Simulation " << i << " (seed " << simulation_seed(master_seed,i) << ") ended with "
+		<< test_ocean.count_last_grid_items(cell_type::turtle) << " turtles, "
+		<< test_ocean.count_last_grid_items(cell_type::ship) << " ships and "
+		<< test_ocean.count_last_grid_items(cell_type::garbage) << " garbage";
+      if ( track_sardines ) { std::cout << ", " << test_ocean.sardine_count() << " sardines"; }
+      std::cout << '\n';
+      return;
+    } // Done replaying
 
     // We can use last_grid_items because last grid is updated after each forward step
+    TRACE_SCOPE("census");
     end_turtles[i] = test_ocean.count_last_grid_items(cell_type::turtle);
     end_ships[i] = test_ocean.count_last_grid_items(cell_type::ship);
     end_garbage[i] = test_ocean.count_last_grid_items(cell_type::garbage);
     end_sardines[i] = test_ocean.sardine_count();
-  } // Looping over the number of simulations to run
+    if ( !cache_dir.empty() ) { outcomes[i] = {end_turtles[i],end_ships[i],end_garbage[i],end_sardines[i]}; }
+  }; // End running one simulation
 
-  // Compute the mean ending amounts of each
-  double turtle_mean = compute_mean(end_turtles);
-  double ship_mean = compute_mean(end_ships);
-  double garbage_mean = compute_mean(end_garbage);
+  // Workers take the next simulation until there are none left
+  std::vector<worker_placement> placement;
+  std::vector<int> worker_sims;
+  if ( replaying ) {
+    std::unique_ptr<ocean> simulation;
+    run_simulation(replay,simulation);
+  }
+  else {
+    int n_workers = std::max(1,std::min(n_threads,n_sims-first_sim));
+    placement = plan_placement(affinity,n_workers);
+    worker_sims.assign(n_workers,0);
+    std::atomic<int> next_sim{first_sim};
+    std::exception_ptr failure;
+    auto work = [&]( int w ) {
+      if ( placement[w].cpu >= 0 && !pin_this_thread(placement[w].cpu) ) { placement[w] = {}; }
+      try {
+	std::unique_ptr<ocean> simulation; // Built here, after pinning, so it is first touched on this worker's node
+	for ( int i=next_sim++ ; i<n_sims ; i=next_sim++ ) {
+	  run_simulation(i,simulation);
+	  worker_sims[w]++;
+	} // End loop over simulations
+      } catch ( ... ) {
+	{
+	  std::lock_guard<std::mutex> guard(output_lock);
+	  if ( !failure ) { failure = std::current_exception(); }
+	  next_sim = n_sims; // Stop the other workers
+	}
+	end_animation(); // Nobody waits on an animation that will not finish
+      }
+    };
+    if ( n_workers == 1 ) { work(0); }
+    else {
+      std::vector<std::thread> workers;
+      for ( int w=0 ; w<n_workers ; w++ ) { workers.emplace_back(work,w); }
+      for ( auto &t : workers ) { t.join(); }
+    }
+    if ( failure ) { std::rethrow_exception(failure); }
+  } // Done running the ensemble
 
-  // Compute the standard deviation amounts of each
-  double turtle_std = compute_std(end_turtles);
-  double ship_std = compute_std(end_ships);
-  double garbage_std = compute_std(end_garbage);
+  if ( !cache_dir.empty() && !replaying && first_sim < n_sims ) { cache.store(key.str(),outcomes); } // Save the longer ensemble
 
-  // Tell the user the results
-  std::cout << "After " << n_sims << " simulations, with " << timesteps << " timesteps each, theresults are in:" << '\n';
-  std::cout << "Listed below is the mean and standard deviation of items left in the ocean at the end of each simulation." << '\n';
-  std::cout << "Mean turtles: " << turtle_mean << '\n';
-  std::cout << "Standard deviation of turtles: " << turtle_std << '\n';
-  std::cout << "Mean ships: " << ship_mean << '\n';
-  std::cout << "Standard deviation of ships: " << ship_std << '\n';
-  std::cout << "Mean garbage: " << garbage_mean << '\n';
-  std::cout << "Standard deviation of garbage: " << garbage_std << '\n';
-  if ( track_sardines == true ) {
-    std::cout << "Mean sardines: " << compute_mean(end_sardines) << '\n';
-    std::cout << "Standard deviation of sardines: " << compute_std(end_sardines) << '\n';
-  } // End displaying sardines if asked for 
+  // Compute the mean and standard deviation of the ending amounts of each, and tell the user
+  if ( !replaying ) {
+    ensemble_summary summary{ n_sims , timesteps ,
+      compute_mean(end_turtles) , compute_std(end_turtles) ,
+      compute_mean(end_ships) , compute_std(end_ships) ,
+      compute_mean(end_garbage) , compute_std(end_garbage) ,
+      compute_mean(end_sardines) , compute_std(end_sardines) };
+    print_summary(summary,track_sardines);
+    std::vector<std::pair<std::string,const std::vector<std::int64_t>*>> extremes{ {"turtles",&end_turtles} , {"garbage",&end_garbage} };
+    if ( track_sardines ) { extremes.push_back({"sardines",&end_sardines}); }
+    print_extremes(extremes,master_seed);
+    if ( placement.size() > 1 || affinity != "none" ) {
+      std::cout << "Ran on " << placement.size() << " worker threads, affinity " << affinity << ":" << '\n';
+      for ( std::size_t w=0 ; w<placement.size() ; w++ ) {
+	std::cout << "  worker " << w << ": ";
+	if ( placement[w].cpu < 0 ) { std::cout << "not pinned"; }
+	else { std::cout << "cpu " << placement[w].cpu << ", NUMA node " << ( placement[w].node < 0 ? std::string("unknown") : std::to_string(placement[w].node) ); }
+	std::cout << ", " << worker_sims[w] << " simulations" << '\n';
+      } // End loop over workers
+    } // Done reporting where the workers ran
+  } // Done with the ensemble summary
+  if ( perf_counters().enabled ) { perf_counters().print_summary(std::cout); }
+
+  if ( result.count("stats") ) {
+    std::string stats_path = result["stats"].as<std::string>();
+    std::ofstream stats_file;
+    if ( stats_path != "-" ) {
+      stats_file.open(stats_path);
+      if (!stats_file) throw std::runtime_error("Could not open "+stats_path+" for writing.");
+    }
+    std::ostream &os = stats_path == "-" ? std::cout : stats_file;
+    os << "{\n  \"n_simulations\": " << n_sims << ",\n  \"timesteps\": " << timesteps
+       << ",\n  \"rows\": " << n_rows << ",\n  \"cols\": " << n_cols
+       << ",\n  \"stats_enabled\": " << ( OCEAN_STATS ? "true" : "false" ) << ",\n  \"counters\": ";
+    stats().total().write_json(os);
+    os << "\n}\n";
+  } // End writing out the stats
+
+  if ( !trace_path.empty() ) { tracer().write_chrome_trace(trace_path); }
 
   // Return the turtle vector, ship vector, and the garbage vector
-  std::tuple<std::vector<int>,std::vector<int>,std::vector<int>> turtles_ships_garbage{end_turtles,end_ships,end_garbage};
+  std::tuple<std::vector<std::int64_t>,std::vector<std::int64_t>,std::vector<std::int64_t>> turtles_ships_garbage{end_turtles,end_ships,end_garbage};
   return 0;
   //return turtles_ships_garbage;
 } // End of int main
@@ -0,0 +1,117 @@
+#pragma once // Guard multiple instances
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+struct meanfield_state {
+  double turtles{0} , ships{0} , garbage{0} , sardines{0};
+};
+
+class meanfield_model {
+  // Population equations for a well mixed ocean, a quick estimate of the
+  // ensemble mean before running thousands of simulations.
+  // Per timestep, with N cells and the open cells being N-turtles-ships:
+  //   - a turtle or random ship steps onto garbage with probability
+  //     new(t)*garbage/open, since random_motion picks uniformly among the
+  //     neighbors it is allowed onto. new(t) is the chance the step lands on
+  //     a cell the walker has not been on before (a cell it has been on has
+  //     already been cleared of garbage, or killed it), the slope of the
+  //     number of distinct cells S(t) ~ 1.5 pi t/ln(25t+120) an 8 neighbor
+  //     random walk visits in t steps (fit to simulated walks). A turtle
+  //     that steps on garbage dies, a ship picks it up:
+  //       d turtles/dt = -turtles * new(t) * garbage/open
+  //       d garbage/dt = -ships * p_pickup
+  //   - a smart ship picks garbage up whenever one of its 8 neighbors has
+  //     some. A step on new ground brings about 3 unseen cells next to it,
+  //     so p_pickup = 1-(1-garbage/N)^(3 new(t))
+  //   - a steered ship (distance field or fleet planner) heads straight for
+  //     the nearest garbage, p_pickup = 1/(2E[d]-1) with E[d] the Chebyshev
+  //     distance from a random cell to the nearest of randomly placed
+  //     garbage. Ships start from cells they just cleared, about twice as
+  //     far out, which the validation harness bears out.
+  // These are integrated with RK4 through each timestep. Every turtle_steps
+  // steps, at the same steps as reproduce_turtles and in the same order,
+  // the turtles are multiplied by turtle_rate (up to the open cells) and the
+  // sardines are eaten and grow: each cell keeps (1-eaten)^k of them for k
+  // turtles around it, which averages to (1-eaten*turtles/N)^9, then grows
+  // by the birth rate, logistically if there is a carrying capacity.
+  // Edges, crowding and the spatial patches the stochastic model forms are
+  // ignored, so this is an estimate and not a replacement for the ensemble.
+public:
+  std::int64_t n_cells{400};
+  double turtle_rate{1.0};
+  int turtle_steps{5};
+  bool smart_ships{false};
+  bool steered_ships{false}; // Smart ships use the distance field or fleet planner
+  bool track_sardines{false};
+  double sardine_birth_rate{1.0} , sardine_eaten_rate{0.0} , sardine_capacity{0.0};
+  int substeps{4}; // RK4 steps per timestep
+
+  static double new_cells( double t ) {
+    // dS/dt for S(t) = a t/ln(b t+c), the cells first visited per step by a walk t steps old
+    constexpr double a = 1.5*M_PI , b = 25.0 , c = 120.0;
+    double l = std::log(b*t+c);
+    return std::clamp( a/l - a*b*t/((b*t+c)*l*l) , 0.0 , 1.0 );
+  } // End the rate of visiting new cells
+
+  double pickup_probability( double garbage , double open , double t ) {
+    // Chance a ship picks garbage up this timestep
+    if ( garbage <= 0 ) { return 0.0; }
+    double density = std::min(1.0,garbage/n_cells);
+    if ( !smart_ships ) { return open > 0 ? new_cells(t)*std::min(1.0,garbage/open) : 0.0; }
+    if ( !steered_ships ) { return 1.0-std::pow(1.0-density,3*new_cells(t)); }
+    // E[d] = sum over r>=0 of P(no garbage within r), a (2r+1)^2 square
+    double expected = 0.0 , none = 1.0;
+    for ( int r=0 ; none > 1e-9 && r < 1000000 ; r++ ) {
+      none = std::pow(1.0-density,(2.0*r+1)*(2.0*r+1));
+      expected += none;
+    } // End summing the distance distribution
+    return 1.0/std::max(1.0,2*expected-1);
+  } // End probability of a pickup
+
+  void rates( const meanfield_state &s , double t , double &d_turtles , double &d_garbage ) {
+    double open = std::max(1.0,n_cells-s.turtles-s.ships);
+    d_turtles = -s.turtles*new_cells(t)*std::min(1.0,s.garbage/open);
+    d_garbage = -std::min(s.garbage,s.ships*pickup_probability(s.garbage,open,t));
+  } // End the rates of change
+
+  void step( meanfield_state &s , int step ) {
+    // One timestep of RK4 on the turtles and garbage
+    double h = 1.0/substeps;
+    for ( int k=0 ; k<substeps ; k++ ) {
+      double t = step+k*h;
+      double t1 , g1 , t2 , g2 , t3 , g3 , t4 , g4;
+      meanfield_state x = s;
+      rates(x,t,t1,g1);
+      x.turtles = s.turtles+0.5*h*t1; x.garbage = s.garbage+0.5*h*g1;
+      rates(x,t+0.5*h,t2,g2);
+      x.turtles = s.turtles+0.5*h*t2; x.garbage = s.garbage+0.5*h*g2;
+      rates(x,t+0.5*h,t3,g3);
+      x.turtles = s.turtles+h*t3; x.garbage = s.garbage+h*g3;
+      rates(x,t+h,t4,g4);
+      s.turtles = std::max(0.0, s.turtles + h*(t1+2*t2+2*t3+t4)/6 );
+      s.garbage = std::max(0.0, s.garbage + h*(g1+2*g2+2*g3+g4)/6 );
+    } // End loop over substeps
+  } // End stepping forward
+
+  void reproduce( meanfield_state &s ) {
+    double open = std::max(0.0,n_cells-s.turtles-s.ships-s.garbage);
+    if ( turtle_rate > 1.0 ) { s.turtles += std::min(open,(turtle_rate-1.0)*s.turtles); }
+    if ( !track_sardines ) { return; }
+    double per_cell = s.sardines/n_cells;
+    per_cell *= std::pow( std::max(0.0,1.0-std::clamp(sardine_eaten_rate,0.0,1.0)*s.turtles/n_cells) , 9 );
+    if ( sardine_capacity > 0 ) { per_cell += (sardine_birth_rate-1.0)*per_cell*(1.0-per_cell/sardine_capacity); }
+    else { per_cell *= sardine_birth_rate; }
+    s.sardines = std::max(0.0,per_cell)*n_cells;
+  } // End reproducing turtles and sardines
+
+  meanfield_state run( meanfield_state s , int T ) {
+    // State after T timesteps, following ocean::simulate
+    for ( int t=0 ; t<T ; t++ ) {
+      step(s,t);
+      if ( turtle_steps > 0 && t%turtle_steps == 0 ) { reproduce(s); }
+    } // End loop over timesteps
+    return s;
+  } // End running the model
+}; // End of mean field model class
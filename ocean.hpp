@@ -2,97 +2,157 @@
 
 #include "grid.hpp"
 #include "random_gen.cpp"
+#include "trace.hpp"
+#include "perf_counters.hpp"
+#include "ocean_currents.hpp"
+#include "sardine_field.hpp"
+#include "sim_generator.hpp"
 #include <vector>
 #include <random>
 #include <stdexcept>
 #include <utility>
 #include <tuple>
 #include <cmath>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
 
 using std::vector;
 
+class ocean;
+
+struct ocean_frame {
+  // What ocean::frames() yields after each timestep: the step just taken and
+  // the ocean it was taken in. Nothing is copied, the counts come from the
+  // grid's count pyramid in O(1), and it is only valid until the next step.
+  int t;
+  ocean &sim;
+
+  grid_2d& grid() const;
+  std::int64_t count( cell_type ct ) const;
+  std::int64_t turtles() const { return count(cell_type::turtle); }
+  std::int64_t ships() const { return count(cell_type::ship); }
+  std::int64_t garbage() const { return count(cell_type::garbage); }
+  double sardines() const; // Sums the sardine field, O(N)
+};
+
 class ocean {
-private:
+protected:
   grid_2d current_grid , last_grid;
-  int n_cells, n_rows , n_cols;
-  int n_sardines;
+  std::int64_t n_cells;
+  int n_rows , n_cols;
+  sardine_field sardines; // Sardine density over the grid
+  int n_steps{0}; // Timesteps taken so far
+  current_field currents; // Water velocity used when ocean currents are on
+  bool use_distance_field{false}; // Smart ships navigate by distance to the nearest garbage
+  garbage_distance distance_field;
+  fleet_planner planner; // Assigns ships to garbage when planner.every > 0
+  bool planner_ready{false}; // Whether the planner has indexed the garbage yet
+  vector<std::pair<int,int>> movers; // Ships and turtles to move this step
 public:
   // creating an ocean of size m and n
-  ocean( int n_rows , int n_cols , int n_sardines ) : current_grid( n_rows , n_cols ) , last_grid( n_rows , n_cols ) , n_cells(n_rows*n_cols) , n_rows(n_rows) , n_cols(n_cols) , n_sardines(n_sardines) {};
+  ocean( int n_rows , int n_cols , int n_sardines ) : current_grid( n_rows , n_cols ) , last_grid( n_rows , n_cols ) , n_cells((std::int64_t)n_rows*n_cols) , n_rows(n_rows) , n_cols(n_cols) , sardines(n_rows,n_cols,n_sardines) {};
+  ocean( const ocean & ) = default;
+  ocean( ocean && ) = default;
+  ocean& operator = ( const ocean & ) = default;
+  ocean& operator = ( ocean && ) = default;
+  virtual ~ocean() = default;
+
+  virtual void reset( int n_sardines ) {
+    // Back to an empty ocean of the same size, as if just constructed, so one
+    // ocean can run simulation after simulation. The grid tiles, sardine field
+    // and scratch vectors keep their memory, and the settings (currents,
+    // navigation, fleet planner, sardine model) are kept too.
+    current_grid.fill(cell_type::water_only);
+    last_grid.fill(cell_type::water_only);
+    sardines.reset(n_sardines);
+    n_steps = 0;
+    planner_ready = false;
+    movers.clear();
+  } // End resetting the ocean
 
   // Methods
   void initiate_grid( int ship_count , int turtle_count, int garbage_count ) { // Initiates the very first grid
-    int total_occupied = ship_count+turtle_count+garbage_count;
+    std::int64_t total_occupied = (std::int64_t)ship_count+turtle_count+garbage_count;
     if (total_occupied > n_cells) throw std::runtime_error("More occupied cells than number of cells in the grid. Fix your inputs.");
- 
-    // Building a vector with the positions of the objects
-    vector<int> grid_locations(total_occupied);
-    std::iota(grid_locations.begin(), grid_locations.end(), 0);
-
-    // Fill in sequentially we will shuffle list later
-    int idx = 0;
-    for ( int ship=0 ; ship < ship_count ; ship++ ) {
-      int i = idx/n_cols;
-      int j = idx%n_cols;
-      last_grid(i,j) = cell_type::ship;
-      idx++;
-    } // End filling with ships
-    
-    for ( int turtle=0 ; turtle < turtle_count ; turtle++ ) {
-      int i = idx/n_cols;
-      int j = idx%n_cols;
-      last_grid(i,j) = cell_type::turtle;
-      idx++;
-    } // End filling with turtles
-    
-    for ( int garbage=0 ; garbage < garbage_count ; garbage++ ) {
-      int i = idx/n_cols;
-      int j = idx%n_cols;
-      last_grid(i,j) = cell_type::garbage;
-      idx++;
-    } // End filling with garbage
-
-    // Done filling grid so shuffle it before we begin
-    last_grid.shuffle_grid();
+
+    if ( 2*total_occupied > n_cells ) {
+      // Crowded ocean: fill in sequentially and shuffle the whole grid
+      std::int64_t idx = 0;
+      for ( int ship=0 ; ship < ship_count ; ship++ ) { last_grid(idx/n_cols,idx%n_cols) = cell_type::ship; idx++; }
+      for ( int turtle=0 ; turtle < turtle_count ; turtle++ ) { last_grid(idx/n_cols,idx%n_cols) = cell_type::turtle; idx++; }
+      for ( int garbage=0 ; garbage < garbage_count ; garbage++ ) { last_grid(idx/n_cols,idx%n_cols) = cell_type::garbage; idx++; }
+      last_grid.shuffle_grid();
+    }
+    else {
+      // Mostly water: drop each object on a random open cell, which gives the
+      // same layouts as the shuffle without touching every cell
+      for ( int ship=0 ; ship < ship_count ; ship++ ) { place_randomly(cell_type::ship); }
+      for ( int turtle=0 ; turtle < turtle_count ; turtle++ ) { place_randomly(cell_type::turtle); }
+      for ( int garbage=0 ; garbage < garbage_count ; garbage++ ) { place_randomly(cell_type::garbage); }
+    } // Done placing the objects
+    planner_ready = false;
   } // Done initiateing tshe random grid
+
+  std::pair<int,int> random_water_cell() {
+    // Uniformly random open water cell of the last grid, {-1,-1} if there is none.
+    // The grid's count pyramid finds it in O(log N) however full the ocean is.
+    return last_grid.sample_cell(cell_type::water_only);
+  } // End finding a random open cell
+
+  bool place_randomly( cell_type t ) {
+    auto [i,j] = random_water_cell();
+    if ( i < 0 ) { return false; }
+    last_grid(i,j) = t;
+    return true;
+  } // End placing something on a random open cell
+
   void print_grid() { last_grid.print_grid(); }; // printout of the grid
 
-  int sardine_count() { return n_sardines; }
-  
+  grid_2d& get_grid() { return last_grid; } // Grid as of the last completed step
+
+  void set_currents( const current_field &field ) { currents = field; }
+
+  void set_distance_navigation( bool on ) { use_distance_field = on; }
+
+  void set_fleet_planner( int every ) { planner.every = every; } // Replan every this many steps, 0 for off
+
+  std::int64_t sardine_count() { return std::llround(sardines.total()); }
+
+  sardine_field& get_sardines() { return sardines; }
+
+  void set_sardine_model( double diffusion , int stencil , double capacity ) {
+    // How the sardines spread (5 or 9 point stencil) and the most a cell can hold (0 for no limit)
+    sardines.diffusion = diffusion;
+    sardines.stencil = stencil;
+    sardines.capacity = capacity;
+  } // End setting the sardine model
+
   void eat_and_reproduce_sardines( double rate_of_birth , double rate_of_eating ) {
-    // Number of turtles in the current ocean
-    int turtle_count = last_grid.get_num_cell_type( cell_type::turtle );
-
-    // Find sardines eaten, subtract that, and get the current number
-    int sardines_eaten = std::round(rate_of_eating*n_sardines);
-    int sardines_after_lunch = std::round(n_sardines - sardines_eaten);
-    int sardines_after_dinner = std::round(n_sardines*rate_of_eating);
-
-    if ( sardines_after_dinner < 0 ) { sardines_after_dinner = 0; }
-    
-    // Set new number of sardines
-    n_sardines = sardines_after_dinner;
+    // Turtles eat the sardines around them, then the rest reproduce and spread out
+    sardines.update( last_grid , rate_of_birth , rate_of_eating );
   } // End reproducing and eating the sardines
 
   void reproduce_turtles( double rate ) {
-    int current_turtle_count = last_grid.get_num_cell_type(cell_type::turtle);
+    TRACE_SCOPE("reproduce_turtles");
+    std::int64_t current_turtle_count = last_grid.get_num_cell_type(cell_type::turtle);
 
     // Get turtles to add
-    int delta_turtles = std::round(rate*current_turtle_count - current_turtle_count);
-
-    for ( int i=0 ; i<delta_turtles ; i++ ) {
-      for ( auto [ii,jj] : permuted_indicies() ) {
-	if (last_grid.get_cell_type(ii,jj) == cell_type::water_only) {
-	  last_grid(ii,jj) = cell_type::turtle;
-	  break;
-	} // Done checking if we can place a turtle here
-      } // End looping over indicies of grid
+    std::int64_t delta_turtles = std::llround(rate*current_turtle_count - current_turtle_count);
+
+    // Each new turtle goes on a uniformly random open cell, the same as taking
+    // the first open cell of a random permutation but without building one
+    for ( std::int64_t i=0 ; i<delta_turtles ; i++ ) {
+      if ( !place_randomly(cell_type::turtle) ) { break; } // Ocean is full
+      STAT_ADD(turtle_births, 1);
     } // End looping over number of turtles to add to the ocean
   } // End reproducing turtles
 
   std::vector<std::pair<int,int>> permuted_indicies() {
-    // Function returns indicies of our grid in a random order (for random updates)
+    // Function returns indicies of our grid in a random order (for random updates).
+    // This holds every cell, so step_forward shuffles only the ships and turtles instead.
     std::vector<pair<int,int>> indicies;
+    indicies.reserve(n_cells);
     for (int i=0 ; i<n_rows ; i++) {
       for (int j=0 ; j<n_cols ; j++) {
 	indicies.push_back({i,j});
@@ -100,11 +160,42 @@ public:
     } // End loop over rows
 
     // Shuffle the indicies and return them
-    auto &generator = engine();                        ;
-    std::shuffle(indicies.begin(),indicies.end(),generator);
+    engine().shuffle(indicies.begin(),indicies.end());
     return indicies;
   } // End shuffling the indicies of the grid
   
+  std::pair<garbage_distance*,fleet_planner*> prepare_navigation( bool smart_ships , bool ocean_currents , grid_2d &garbage ) {
+    // Builds what the ships steer by this step from the garbage in the given grid,
+    // returning the distance field and fleet planner to use (nullptr for off)
+
+    // Smart ships get a fresh map of the distance to the nearest garbage
+    garbage_distance *field = nullptr;
+    if ( smart_ships && use_distance_field ) {
+      TRACE_SCOPE("distance_field");
+      distance_field.build(n_rows,n_cols,[&](int i, int j) { return garbage.get_cell_type(i,j) == cell_type::garbage; });
+      field = &distance_field;
+    } // Done building the distance field
+
+    // The fleet planner indexes the garbage once and replans every so often.
+    // If currents move the garbage it is indexed again every step, which
+    // drops the claims, so it replans every step too.
+    fleet_planner *fleet = nullptr;
+    if ( planner.every > 0 ) {
+      TRACE_SCOPE("fleet_planner");
+      if ( !planner_ready || ocean_currents ) {
+	planner.build_index(n_rows,n_cols,[&](int i, int j) { return garbage.get_cell_type(i,j) == cell_type::garbage; });
+	planner_ready = true;
+      } // Done indexing the garbage
+      if ( n_steps % planner.every == 0 || ocean_currents ) {
+	vector<std::int64_t> ships;
+	last_grid.for_each_cell({cell_type::ship},[&](int i, int j, cell_type) { ships.push_back((std::int64_t)i*n_cols+j); });
+	planner.plan(ships);
+      } // Done planning
+      fleet = &planner;
+    } // Done with the fleet planner
+    return {field,fleet};
+  } // End preparing the ships' navigation
+
   void step_forward(bool smart_ships, bool ocean_currents) { // Steps forward in time one step
     // Below is the diagram for how are ships will pick to move
     // 0  1  2
@@ -112,36 +203,93 @@ public:
     // 6  5  4
     // Ship will pick a random square around it assuming it is not
     // the edge and then it will move it there
-    
+    TRACE_SCOPE("step_forward");
+
     // First loop over and transfer just the garbage to the new grid
-    for ( int i=0 ; i < n_rows ; i++ ) {
-      for ( int j=0 ; j < n_cols ; j++ ) {
-	cell_type cur_type = last_grid(i,j).get_cell_type();
-	if ( cur_type == cell_type::garbage ) { current_grid(i,j) = cur_type; }
-	else { current_grid(i,j) = cell_type::water_only; }
-      } // End loop over columns
-    } // End loop over rows
+    {
+      phase_timer timer(sim_phase::garbage_copy);
+      perf_scope perf(sim_phase::garbage_copy);
+      TRACE_SCOPE("garbage_copy");
+      if ( ocean_currents ) {
+	// Currents carry the garbage into the new grid, default to a gyre if no field was given
+	if ( currents.empty() ) { currents = current_field::gyre(n_rows,n_cols,0.5f); }
+	current_grid.fill(cell_type::water_only);
+	currents.advect(last_grid,current_grid,n_steps);
+      } // Done moving garbage with the currents
+      else {
+	current_grid.copy_type(last_grid,cell_type::garbage);
+      } // Done copying garbage in place
+    } // Done copying the garbage
+
+    auto [field,fleet] = prepare_navigation(smart_ships,ocean_currents,current_grid);
 
     // Next do loop over whole ocean, this time randomly so change up the order of update
-    for ( auto [i,j] : permuted_indicies() ) {
-      last_grid.random_motion(i,j,current_grid,smart_ships,ocean_currents);
-    } // End loop over permuted indicies
-    last_grid = current_grid; // Update the last grid to be the current grid
+    {
+      phase_timer timer(sim_phase::motion_sweep);
+      perf_scope perf(sim_phase::motion_sweep);
+      TRACE_SCOPE("random_motion_sweep");
+      // Only ships and turtles move, so visiting just them in a random order is
+      // the same as visiting every cell of a random permutation of the grid.
+      // Tiles with neither are skipped without looking at their cells.
+      movers.clear();
+      last_grid.for_each_cell({cell_type::ship,cell_type::turtle},[&](int i, int j, cell_type) { movers.push_back({i,j}); });
+      engine().shuffle(movers.begin(),movers.end());
+      for ( auto [i,j] : movers ) {
+	last_grid.random_motion(i,j,current_grid,smart_ships,ocean_currents,field,fleet);
+      } // End loop over permuted movers
+    } // Done moving everything
+
+    n_steps++;
+    phase_timer timer(sim_phase::grid_copy);
+    perf_scope perf(sim_phase::grid_copy);
+    TRACE_SCOPE("grid_copy");
+    std::swap(last_grid,current_grid); // The current grid is the last grid now, and the old one is rewritten next step
   } // End grid update
 
   int count_around(int i, int j, cell_type ct) { return last_grid.count_around(i,j,ct); }
 
-  int count_last_grid_items(cell_type ct) { return last_grid.get_num_cell_type(ct); }
+  std::int64_t count_last_grid_items(cell_type ct) { return last_grid.get_num_cell_type(ct); } // O(1) from the counts
+
+  std::int64_t count_region(cell_type ct, int i0, int j0, int i1, int j1) { return last_grid.count_region(ct,i0,j0,i1,j1); } // Census of rows i0..i1-1, columns j0..j1-1
   
-  void simulate( int T , double turtle_rate , int turtle_steps , bool smart_ships , bool ocean_currents , bool track_sardines , double sardine_birth_rate , double sardine_eaten_rate ) { // Simulates for T time steps
-    for ( int t=0; t < T; t++ ) {
-      step_forward(smart_ships,ocean_currents);
-      if ( t%turtle_steps == 0 ) {
-	reproduce_turtles(turtle_rate);
-	if ( track_sardines ) {
-	  eat_and_reproduce_sardines(sardine_birth_rate, sardine_eaten_rate);
-	} // Done reproducting sardines
-      } // Done reproducing turtles
+  virtual void advance( int t , double turtle_rate , int turtle_steps , bool smart_ships , bool ocean_currents , bool track_sardines , double sardine_birth_rate , double sardine_eaten_rate ) {
+    // Timestep t: everything moves, then every turtle_steps steps the turtles and sardines reproduce
+    step_forward(smart_ships,ocean_currents);
+    if ( t%turtle_steps == 0 ) {
+      phase_timer timer(sim_phase::reproduction);
+      perf_scope perf(sim_phase::reproduction);
+      reproduce_turtles(turtle_rate);
+      if ( track_sardines ) {
+	eat_and_reproduce_sardines(sardine_birth_rate, sardine_eaten_rate);
+      } // Done reproducting sardines
+    } // Done reproducing turtles
+  } // End one timestep
+
+  sim_generator<const ocean_frame&> frames( int T , double turtle_rate , int turtle_steps , bool smart_ships , bool ocean_currents , bool track_sardines , double sardine_birth_rate , double sardine_eaten_rate );
+
+  void simulate( int T , double turtle_rate , int turtle_steps , bool smart_ships , bool ocean_currents , bool track_sardines , double sardine_birth_rate , double sardine_eaten_rate ,
+		 const std::function<void(int)> &on_step = {} ) { // Simulates T more time steps, calling on_step(t) after each one
+    TRACE_SCOPE("simulate");
+    // A negative T takes no steps here, only frames() runs without end
+    for ( const ocean_frame &frame : frames(std::max(T,0),turtle_rate,turtle_steps,smart_ships,ocean_currents,track_sardines,sardine_birth_rate,sardine_eaten_rate) ) {
+      if ( on_step ) { on_step(frame.t); }
     } // End loop over all timesteps
   } // End simulation
 }; // End defining the ocean class
+
+inline grid_2d& ocean_frame::grid() const { return sim.get_grid(); }
+inline std::int64_t ocean_frame::count( cell_type ct ) const { return sim.count_last_grid_items(ct); }
+inline double ocean_frame::sardines() const { return sim.get_sardines().total(); }
+
+inline sim_generator<const ocean_frame&> ocean::frames( int T , double turtle_rate , int turtle_steps , bool smart_ships , bool ocean_currents , bool track_sardines , double sardine_birth_rate , double sardine_eaten_rate ) {
+  // Lazily simulates up to T more timesteps (without end if T is negative),
+  // one per iteration, so a caller can stream, thin out or stop early:
+  //   for ( auto &f : o.frames(-1,...) ) { if ( f.garbage() == 0 ) break; }
+  // Breaking out leaves the ocean after the last step taken, and a later
+  // call carries on from there.
+  int first = n_steps; // Carries on from earlier calls
+  for ( int t=first; T < 0 || t < first+T; t++ ) {
+    advance(t,turtle_rate,turtle_steps,smart_ships,ocean_currents,track_sardines,sardine_birth_rate,sardine_eaten_rate);
+    co_yield ocean_frame{t,*this};
+  } // End loop over timesteps
+} // End streaming frames
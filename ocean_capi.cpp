@@ -0,0 +1,118 @@
+// C interface to the ocean simulation, see ocean_capi.h
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <exception>
+#include "ocean_capi.h"
+#include "ocean.hpp"
+#include "kmc_ocean.hpp"
+
+struct ocean_sim {
+  ocean_params params;
+  std::unique_ptr<ocean> sim;
+  int64_t steps{0};
+};
+
+namespace {
+  thread_local std::string last_error;
+
+  int fail( const std::exception &e ) {
+    last_error = e.what();
+    return -1;
+  } // End recording an error
+
+  void start( ocean_sim &s , uint64_t seed ) {
+    // Fresh random layout, in the ocean we already have if there is one
+    const ocean_params &p = s.params;
+    seed_engine(seed);
+    if ( s.sim ) { s.sim->reset((int)p.sardines); }
+    else {
+      if ( p.kmc ) { s.sim = std::make_unique<kmc_ocean>(p.rows,p.cols,(int)p.sardines); }
+      else { s.sim = std::make_unique<ocean>(p.rows,p.cols,(int)p.sardines); }
+      s.sim->set_distance_navigation(p.distance_field != 0);
+      s.sim->set_fleet_planner(p.fleet_planner);
+    } // Done getting an empty ocean
+    s.sim->initiate_grid(p.ships,p.turtles,p.garbage);
+    s.steps = 0;
+  } // End starting an ocean
+}
+
+extern "C" {
+
+int ocean_capi_version( void ) { return OCEAN_CAPI_VERSION; }
+
+void ocean_default_params( ocean_params *params ) {
+  *params = ocean_params{};
+  params->rows = params->cols = 20;
+  params->turtles = 10;
+  params->ships = 5;
+  params->garbage = 15;
+  params->turtle_rate = 1.0;
+  params->turtle_steps = 5;
+  params->sardines = 100;
+  params->sardine_birth_rate = 1.0;
+} // End filling in the default parameters
+
+ocean_sim* ocean_create( const ocean_params *params , uint64_t seed ) {
+  try {
+    if ( !params ) throw std::runtime_error("No parameters given.");
+    if ( params->rows <= 0 || params->cols <= 0 ) throw std::runtime_error("The ocean needs at least one row and column.");
+    if ( params->turtle_steps <= 0 ) throw std::runtime_error("turtle_steps must be positive.");
+    auto s = std::make_unique<ocean_sim>();
+    s->params = *params;
+    start(*s,seed);
+    return s.release();
+  } catch ( const std::exception &e ) {
+    fail(e);
+    return nullptr;
+  }
+} // End creating an ocean
+
+void ocean_destroy( ocean_sim *sim ) { delete sim; }
+
+int ocean_reset( ocean_sim *sim , uint64_t seed ) {
+  try {
+    start(*sim,seed);
+    return 0;
+  } catch ( const std::exception &e ) { return fail(e); }
+} // End resetting an ocean
+
+int ocean_step( ocean_sim *sim , int timesteps ) {
+  try {
+    if ( timesteps < 0 ) throw std::runtime_error("timesteps must not be negative.");
+    const ocean_params &p = sim->params;
+    sim->sim->simulate(timesteps,p.turtle_rate,p.turtle_steps,p.smart_ships != 0,p.ocean_currents != 0,
+		       p.track_sardines != 0,p.sardine_birth_rate,p.sardine_eaten_rate);
+    sim->steps += timesteps;
+    return 0;
+  } catch ( const std::exception &e ) { return fail(e); }
+} // End stepping an ocean
+
+int64_t ocean_timestep( const ocean_sim *sim ) { return sim->steps; }
+
+int64_t ocean_count( const ocean_sim *sim , int type ) {
+  if ( type < 0 || type > 3 ) { return -1; }
+  return sim->sim->count_last_grid_items(static_cast<cell_type>(type));
+} // End counting a cell type
+
+double ocean_sardines( const ocean_sim *sim ) { return sim->sim->get_sardines().total(); }
+
+void ocean_grid( const ocean_sim *sim , ocean_grid_info *info ) {
+  grid_2d &g = sim->sim->get_grid();
+  info->rows = g.rows();
+  info->cols = g.cols();
+  info->tile_side = cell_storage<cell>::tile_side;
+  info->tile_rows = g.tile_rows();
+  info->tile_cols = g.tile_cols();
+} // End describing the grid
+
+const uint8_t* ocean_tile( const ocean_sim *sim , int64_t tile_i , int64_t tile_j ) {
+  grid_2d &g = sim->sim->get_grid();
+  if ( tile_i < 0 || tile_j < 0 || tile_i >= g.tile_rows() || tile_j >= g.tile_cols() ) { return nullptr; }
+  return reinterpret_cast<const uint8_t*>( g.tile_view(tile_i,tile_j) ); // cell is a single byte
+} // End viewing a tile
+
+const char* ocean_last_error( void ) { return last_error.c_str(); }
+
+} // extern "C"
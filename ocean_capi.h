@@ -0,0 +1,81 @@
+/* C interface to the ocean simulation, for calling it in process from other
+ * languages and tools. Build the ocean_sim library target and link to it.
+ *
+ * An ocean_sim is created from an ocean_params, stepped forward any number
+ * of timesteps and reset to a fresh random start without being freed.
+ * The grid can be read without copying it: it is stored in tiles of
+ * tile_side x tile_side one byte cells (0 water, 1 turtle, 2 ship,
+ * 3 garbage), row major inside a tile, and ocean_tile() hands out a read
+ * only pointer to one. Cell (i,j) is
+ *   ocean_tile(sim, i/tile_side, j/tile_side)[(i%tile_side)*tile_side + j%tile_side]
+ * Tiles that are all water share one read only tile. Tile pointers stay
+ * valid until the next ocean_step, ocean_reset or ocean_destroy.
+ *
+ * Functions that can fail return 0 on success and -1 on failure, with the
+ * reason in ocean_last_error(). Each thread has its own random engine,
+ * which ocean_create and ocean_reset seed, so different oceans can run on
+ * different threads at once; keep each ocean on one thread for repeatable
+ * runs.
+ */
+#ifndef OCEAN_CAPI_H
+#define OCEAN_CAPI_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OCEAN_CAPI_VERSION 1
+
+typedef struct ocean_sim ocean_sim; /* Opaque handle */
+
+typedef struct ocean_params {
+  int rows , cols;
+  int turtles , ships , garbage;
+  double turtle_rate;    /* Turtles are multiplied by this ... */
+  int turtle_steps;      /* ... every this many timesteps */
+  int smart_ships;       /* Nonzero for ships that grab garbage next to them */
+  int distance_field;    /* Nonzero for smart ships that head for the nearest garbage anywhere */
+  int fleet_planner;     /* Replan ship targets every this many timesteps, 0 for off */
+  int ocean_currents;    /* Nonzero for garbage drifting in a gyre */
+  int track_sardines;    /* Nonzero to update the sardine field */
+  double sardines , sardine_birth_rate , sardine_eaten_rate;
+  int kmc;               /* Nonzero for the continuous time event model */
+} ocean_params;
+
+typedef struct ocean_grid_info {
+  int64_t rows , cols;
+  int64_t tile_side;            /* Cells along each side of a tile */
+  int64_t tile_rows , tile_cols; /* Number of tiles down and across */
+} ocean_grid_info;
+
+int ocean_capi_version( void );
+
+void ocean_default_params( ocean_params *params ); /* The defaults of the command line program */
+
+ocean_sim* ocean_create( const ocean_params *params , uint64_t seed ); /* NULL on failure */
+
+void ocean_destroy( ocean_sim *sim );
+
+int ocean_reset( ocean_sim *sim , uint64_t seed ); /* New random start with the same parameters */
+
+int ocean_step( ocean_sim *sim , int timesteps ); /* -1 if timesteps is negative */
+
+int64_t ocean_timestep( const ocean_sim *sim ); /* Timesteps taken since the last reset */
+
+int64_t ocean_count( const ocean_sim *sim , int type ); /* Cells of a type, -1 for a bad type */
+
+double ocean_sardines( const ocean_sim *sim );
+
+void ocean_grid( const ocean_sim *sim , ocean_grid_info *info );
+
+const uint8_t* ocean_tile( const ocean_sim *sim , int64_t tile_i , int64_t tile_j ); /* NULL if out of range */
+
+const char* ocean_last_error( void );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* OCEAN_CAPI_H */
@@ -0,0 +1,134 @@
+#pragma once // Guard multiple instances
+
+#include "grid.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+class current_field {
+  // Velocity of the water at every cell, in cells per timestep.
+  // v_row points down the grid (increasing i) and v_col to the right (increasing j).
+private:
+  int m{0} , n{0};
+  vector<float> v_row , v_col;
+  vector<int> shift_i , shift_j; // Scratch for one row of a tile
+public:
+  static constexpr int tile = cell_storage<cell>::tile_side; // Columns (and rows) handled per block of the advection pass, one grid tile
+
+  current_field() = default;
+  current_field( int m , int n ) : m(m) , n(n) , v_row((std::size_t)m*n,0.f) , v_col((std::size_t)m*n,0.f) {};
+
+  bool empty() { return v_row.empty(); }
+
+  void set_velocity( int i , int j , float vi , float vj ) {
+    v_row.at((std::size_t)i*n+j) = vi;
+    v_col.at((std::size_t)i*n+j) = vj;
+  } // End setting the velocity of one cell
+
+  static current_field uniform( int m , int n , float vi , float vj ) {
+    current_field f(m,n);
+    std::fill(f.v_row.begin(),f.v_row.end(),vi);
+    std::fill(f.v_col.begin(),f.v_col.end(),vj);
+    return f;
+  } // End making a uniform current
+
+  static current_field gyre( int m , int n , float speed ) {
+    // Clockwise rotation about the center of the grid, moving at speed at the
+    // edge of the largest circle that fits, with a slight pull towards the
+    // middle so garbage collects into a patch like a real gyre.
+    current_field f(m,n);
+    float ci = 0.5f*(m-1) , cj = 0.5f*(n-1);
+    float radius = std::max(1.f,0.5f*std::min(m,n));
+    for (int i=0 ; i<m ; i++) {
+      for (int j=0 ; j<n ; j++) {
+	float di = (i-ci)/radius , dj = (j-cj)/radius;
+	f.v_row[(std::size_t)i*n+j] = speed*( dj - 0.1f*di );
+	f.v_col[(std::size_t)i*n+j] = speed*( -di - 0.1f*dj );
+      } // End loop over columns
+    } // End loop over rows
+    return f;
+  } // End making a gyre
+
+  static current_field from_file( int m , int n , const std::string &path ) {
+    // File holds "rows cols" followed by "v_row v_col" for every cell, row by row
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Could not open current field "+path);
+    int file_m , file_n;
+    file >> file_m >> file_n;
+    if ( file_m != m || file_n != n ) throw std::runtime_error("Current field in "+path+" does not match the ocean size.");
+    current_field f(m,n);
+    for (std::size_t k=0 ; k<f.v_row.size() ; k++) {
+      if ( !(file >> f.v_row[k] >> f.v_col[k]) ) throw std::runtime_error("Current field in "+path+" is missing values.");
+    } // End reading the velocities
+    return f;
+  } // End reading a current field
+
+  static current_field parse( int m , int n , const std::string &spec ) {
+    // spec is uniform:<v_row>,<v_col> , gyre:<speed> or file:<path>
+    auto colon = spec.find(':');
+    std::string kind = spec.substr(0,colon);
+    std::string args = colon==std::string::npos ? "" : spec.substr(colon+1);
+    if ( kind == "file" ) { return from_file(m,n,args); }
+    std::replace(args.begin(),args.end(),',',' ');
+    std::istringstream values(args);
+    float a = 0.5f , b = 0.f;
+    if ( kind == "gyre" ) {
+      values >> a;
+      return gyre(m,n,a);
+    }
+    if ( kind == "uniform" ) {
+      values >> a >> b;
+      return uniform(m,n,a,b);
+    }
+    throw std::runtime_error("Unknown current field "+spec+", use uniform:<v_row>,<v_col>, gyre:<speed> or file:<path>.");
+  } // End building a current field from the command line
+
+  void advect( grid_2d &last , grid_2d &g , int step ) {
+    // Moves the garbage of last into g (which should hold only water) for timestep step.
+    // A cell with velocity v moves its garbage floor(v*(step+1)) - floor(v*step)
+    // cells, so over many steps garbage drifts at exactly v on average without
+    // needing any random numbers. Garbage only drifts into cells that were open
+    // water last step and have not been claimed this step, so two pieces never
+    // end up in one cell and nothing lands on a ship or turtle.
+    if ( (int)shift_i.size() < tile ) {
+      shift_i.resize(tile);
+      shift_j.resize(tile);
+    }
+    const float now = step , next = step+1;
+
+    for (int i0=0 ; i0<m ; i0+=tile) {
+      for (int j0=0 ; j0<n ; j0+=tile) {
+	if ( last.tile_count(i0/tile,j0/tile,cell_type::garbage) == 0 ) { continue; } // No garbage to move here
+	int i1 = std::min(m,i0+tile) , j1 = std::min(n,j0+tile);
+	for (int i=i0 ; i<i1 ; i++) {
+	  // Displacements for this row of the tile, a straight loop over floats the compiler can vectorize
+	  const float *vi = v_row.data()+(std::size_t)i*n+j0 , *vj = v_col.data()+(std::size_t)i*n+j0;
+	  int *si = shift_i.data() , *sj = shift_j.data();
+	  int width = j1-j0;
+	  for (int k=0 ; k<width ; k++) {
+	    si[k] = (int)std::floor(vi[k]*next) - (int)std::floor(vi[k]*now);
+	    sj[k] = (int)std::floor(vj[k]*next) - (int)std::floor(vj[k]*now);
+	  } // End computing the displacements
+
+	  for (int k=0 ; k<width ; k++) {
+	    int j = j0+k;
+	    if ( last.get_cell_type(i,j) != cell_type::garbage ) { continue; }
+	    int ti = std::clamp(i+si[k],0,m-1);
+	    int tj = std::clamp(j+sj[k],0,n-1);
+	    if ( (ti!=i || tj!=j) && last.get_cell_type(ti,tj) == cell_type::water_only
+		 && g.get_cell_type(ti,tj) != cell_type::garbage ) {
+	      g.set_cell_type(ti,tj,cell_type::garbage);
+	    } // Garbage drifts to its new cell
+	    else {
+	      g.set_cell_type(i,j,cell_type::garbage);
+	    } // Garbage stays where it is
+	  } // End moving the garbage in this row
+	} // End loop over rows of the tile
+      } // End loop over column tiles
+    } // End loop over row tiles
+  } // End advecting the garbage
+}; // End of current field class
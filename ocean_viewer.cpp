@@ -0,0 +1,82 @@
+// Live view of a simulation started with --live <name>. Attaches to the
+// simulation's frame ring in shared memory (frame_ring.hpp), draws the newest
+// frame in the terminal every so often and detaches on Ctrl-C or when the
+// simulation ends. The simulation never waits on the viewer, so frames that
+// come faster than the interval are skipped.
+//
+// Usage: ocean_viewer [--name /ocean] [--interval 100] [--width 100] [--height 40]
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <csignal>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "frame_ring.hpp"
+#include "frame_renderer.hpp"
+
+namespace {
+  volatile std::sig_atomic_t stop = 0;
+  void on_interrupt( int ) { stop = 1; }
+}
+
+int main( int argc , char **argv ) {
+  std::string name = "/ocean";
+  int interval = 100 , width = 100 , height = 40;
+  for ( int a=1 ; a+1<argc ; a+=2 ) {
+    std::string flag = argv[a];
+    if      ( flag == "--name" )     { name = argv[a+1]; }
+    else if ( flag == "--interval" ) { interval = std::max(1,std::atoi(argv[a+1])); }
+    else if ( flag == "--width" )    { width = std::max(1,std::atoi(argv[a+1])); }
+    else if ( flag == "--height" )   { height = std::max(1,std::atoi(argv[a+1])); }
+    else { std::cerr << "Unknown option " << flag << '\n'; return 1; }
+  } // End reading the options
+
+  try {
+    frame_ring_reader ring(name);
+    std::signal(SIGINT,on_interrupt);
+    std::signal(SIGTERM,on_interrupt);
+
+    frame_renderer renderer;
+    ring_frame frame;
+    std::uint64_t shown = 0 , skipped = 0;
+    bool any = false;
+    while ( !stop ) {
+      bool done = ring.finished(); // Checked first so the last frame is still drawn
+      if ( ring.latest(frame) && ( !any || frame.frame != shown ) ) {
+	if ( any ) { skipped += frame.frame-shown-1; }
+	shown = frame.frame;
+	any = true;
+	// Scale the frame down to the terminal, keeping the most visible type of each block
+	int block_rows = (frame.rows+height-1)/height , block_cols = (frame.cols+width-1)/width;
+	int m = (frame.rows+block_rows-1)/block_rows , n = (frame.cols+block_cols-1)/block_cols;
+	auto append_row = [&]( int i , std::string &out ) {
+	  for ( int j=0 ; j<n ; j++ ) {
+	    cell_type best = cell_type::water_only;
+	    for ( int r=i*block_rows ; r<std::min(frame.rows,(i+1)*block_rows) ; r++ ) {
+	      for ( int c=j*block_cols ; c<std::min(frame.cols,(j+1)*block_cols) ; c++ ) {
+		if ( frame_ring_rank(frame.at(r,c)) > frame_ring_rank(best) ) { best = frame.at(r,c); }
+	      } // End loop over block columns
+	    } // End loop over block rows
+	    out.push_back(cell_glyph(best));
+	  } // End loop over columns
+	};
+	renderer.draw(m,append_row,
+		      "simulation " + std::to_string(frame.simulation) + "  timestep " + std::to_string(frame.timestep) +
+		      "  turtles " + std::to_string(frame.counts[static_cast<int>(cell_type::turtle)]) +
+		      "  ships " + std::to_string(frame.counts[static_cast<int>(cell_type::ship)]) +
+		      "  garbage " + std::to_string(frame.counts[static_cast<int>(cell_type::garbage)]) +
+		      "  (" + std::to_string(ring.rows()) + "x" + std::to_string(ring.cols()) +
+		      ", frames skipped " + std::to_string(skipped) + ")");
+      } // Done drawing a new frame
+      if ( done ) { break; }
+      std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    } // End loop over redraws
+    renderer.finish();
+  } catch ( const std::exception &e ) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+} // End of main
@@ -0,0 +1,196 @@
+#pragma once // Guard multiple instances
+
+#include "sim_stats.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters per simulation phase, read through Linux
+// perf_event_open. Each thread opens its own counter group the first time it
+// enters a phase, and every phase reads the group on entry and exit. Off
+// unless start_perf_counters() is called (see --perf in main.cpp).
+
+inline constexpr int n_perf_events = 5;
+
+inline const char* perf_event_name( int k ) {
+  static constexpr const char *names[n_perf_events] = { "cycles" , "instructions" , "L1D misses" , "LLC misses" , "branch misses" };
+  return names[k];
+} // End getting the name of a counter
+
+struct perf_totals {
+  std::array<std::array<double,n_perf_events>,n_sim_phases> counts{}; // Scaled for multiplexing
+  void add( const perf_totals &other ) {
+    for (int p=0 ; p<n_sim_phases ; p++) {
+      for (int k=0 ; k<n_perf_events ; k++) { counts[p][k] += other.counts[p][k]; }
+    } // End loop over phases
+  } // End adding another set of totals
+};
+
+class perf_group {
+  // One group of counters (cycles is the leader) for the calling thread
+private:
+  int fds[n_perf_events];
+  int n_open{0};
+  bool opened{false};
+public:
+  std::string error; // Why the counters could not be opened, if they could not
+  std::string missing; // Counters this machine does not have
+
+  perf_group() {
+    for ( int &fd : fds ) { fd = -1; }
+#if defined(__linux__)
+    const std::uint64_t cache_read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    const std::uint32_t types[n_perf_events] = { PERF_TYPE_HARDWARE , PERF_TYPE_HARDWARE , PERF_TYPE_HW_CACHE , PERF_TYPE_HW_CACHE , PERF_TYPE_HARDWARE };
+    const std::uint64_t configs[n_perf_events] = { PERF_COUNT_HW_CPU_CYCLES , PERF_COUNT_HW_INSTRUCTIONS ,
+						   PERF_COUNT_HW_CACHE_L1D | cache_read_miss ,
+						   PERF_COUNT_HW_CACHE_LL | cache_read_miss ,
+						   PERF_COUNT_HW_BRANCH_MISSES };
+    for (int k=0 ; k<n_perf_events ; k++) {
+      perf_event_attr attr;
+      std::memset(&attr,0,sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = types[k];
+      attr.config = configs[k];
+      attr.disabled = ( k==0 );
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds[k] = syscall(SYS_perf_event_open,&attr,0,-1,k==0 ? -1 : fds[0],0);
+      if ( fds[k] >= 0 ) { n_open++; continue; }
+      if ( k==0 ) {
+	error = std::string("perf_event_open failed: ") + std::strerror(errno);
+	return;
+      } // Without the group leader there is nothing to count
+      missing += ( missing.empty() ? "" : ", " ) + std::string(perf_event_name(k));
+    } // End loop over counters
+    ioctl(fds[0],PERF_EVENT_IOC_RESET,PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0],PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+    opened = true;
+#else
+    error = "hardware counters need Linux perf_event_open";
+#endif
+  }
+
+  ~perf_group() { close_all(); }
+
+  void close_all() {
+#if defined(__linux__)
+    for ( int &fd : fds ) { if ( fd >= 0 ) { close(fd); } fd = -1; }
+#endif
+    opened = false;
+  } // End closing the counters
+
+  bool ok() { return opened; }
+
+  bool read_counts( std::array<double,n_perf_events> &out ) {
+    // Reads every counter, scaled up if the kernel had to multiplex them.
+    // Counters that could not be opened read as zero.
+#if defined(__linux__)
+    if ( !opened ) { return false; }
+    std::uint64_t buffer[3+n_perf_events];
+    ssize_t expected = (3+n_open)*sizeof(std::uint64_t);
+    if ( read(fds[0],buffer,sizeof(buffer)) != expected ) { return false; }
+    double scale = buffer[2]>0 ? (double)buffer[1]/buffer[2] : 1.0;
+    int slot = 3;
+    for (int k=0 ; k<n_perf_events ; k++) { out[k] = fds[k]>=0 ? buffer[slot++]*scale : 0.0; }
+    return true;
+#else
+    (void)out;
+    return false;
+#endif
+  } // End reading the counters
+}; // End of perf group
+
+class perf_registry {
+private:
+  std::mutex lock;
+  std::vector<std::unique_ptr<perf_totals>> per_thread;
+public:
+  bool enabled{false};
+  std::string error; // First error any thread hit opening its counters
+  std::string missing;
+
+  perf_totals* add_thread( const std::string &thread_error , const std::string &thread_missing ) {
+    std::lock_guard<std::mutex> guard(lock);
+    if ( error.empty() ) { error = thread_error; }
+    if ( missing.empty() ) { missing = thread_missing; }
+    per_thread.push_back( std::make_unique<perf_totals>() );
+    return per_thread.back().get();
+  } // End adding totals for a new thread
+
+  perf_totals total() {
+    std::lock_guard<std::mutex> guard(lock);
+    perf_totals sum;
+    for ( auto &t : per_thread ) { sum.add(*t); }
+    return sum;
+  } // End merging all threads
+
+  void print_summary( std::ostream &os ) {
+    perf_totals sum = total();
+    if ( !error.empty() ) {
+      os << "Hardware counters unavailable: " << error << '\n';
+      return;
+    }
+    os << "Hardware counters per phase (perf_event_open):" << '\n';
+    os << std::left << std::setw(14) << "phase";
+    for (int k=0 ; k<n_perf_events ; k++) { os << std::right << std::setw(16) << perf_event_name(k); }
+    os << std::setw(8) << "IPC" << '\n';
+    if ( !missing.empty() ) { os << "(not supported here, shown as 0: " << missing << ")" << '\n'; }
+    for (int p=0 ; p<n_sim_phases ; p++) {
+      auto &c = sum.counts[p];
+      os << std::left << std::setw(14) << phase_name(static_cast<sim_phase>(p)) << std::right;
+      for (int k=0 ; k<n_perf_events ; k++) { os << std::setw(16) << std::fixed << std::setprecision(0) << c[k]; }
+      os << std::setw(8) << std::setprecision(2) << ( c[0]>0 ? c[1]/c[0] : 0.0 ) << '\n';
+      os.unsetf(std::ios::fixed);
+      os << std::setprecision(6);
+    } // End loop over phases
+  } // End printing the counters
+}; // End of perf registry
+
+inline perf_registry& perf_counters() {
+  static perf_registry registry;
+  return registry;
+} // End getting the global perf registry
+
+inline void start_perf_counters() { perf_counters().enabled = true; }
+
+struct perf_thread_state {
+  perf_group group;
+  perf_totals *totals;
+  perf_thread_state() : totals( perf_counters().add_thread(group.error,group.missing) ) {};
+};
+
+class perf_scope {
+  // Adds the counter deltas between construction and destruction to a phase
+private:
+  sim_phase phase;
+  perf_thread_state *state{nullptr};
+  std::array<double,n_perf_events> start{};
+public:
+  perf_scope( sim_phase p ) : phase(p) {
+    if ( !perf_counters().enabled ) { return; }
+    thread_local perf_thread_state mine;
+    if ( mine.group.read_counts(start) ) { state = &mine; }
+  }
+  ~perf_scope() {
+    if ( !state ) { return; }
+    std::array<double,n_perf_events> end;
+    if ( !state->group.read_counts(end) ) { return; }
+    auto &c = state->totals->counts[ static_cast<int>(phase) ];
+    for (int k=0 ; k<n_perf_events ; k++) { c[k] += end[k]-start[k]; }
+  }
+}; // End of perf scope
@@ -1,8 +1,129 @@
 #pragma once // Guard multiple instances
 
 #include <random>
+#include <cstdint>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <utility>
 
-std::default_random_engine& engine() {
-  static std::default_random_engine g{ std::random_device{}() };
+// Bump whenever a change makes the same seed give different simulations,
+// so cached results from the old behavior are not reused
+constexpr int engine_version = 4;
+
+inline std::uint64_t splitmix64( std::uint64_t x ) {
+  // Scrambles x into a well mixed 64 bit value (Steele, Lea and Flood's SplitMix64)
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+class ocean_engine {
+  // xoshiro256++ (Blackman and Vigna), a small fast generator with 256 bits
+  // of state, handing out 64 bit words from a block that is refilled in one
+  // tight loop. On top of the words it gives the draws the simulation needs:
+  //   - direction(): 0..7 from 3 bits of a word, 21 draws per word
+  //   - below(s): 0..s-1 with Lemire's nearly divisionless method, one
+  //     multiply and almost never a division
+  //   - uniform(): a double in [0,1) from the top 53 bits
+  // It is a UniformRandomBitGenerator, so std::shuffle and the standard
+  // distributions take it too.
+public:
+  using result_type = std::uint64_t;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~result_type(0); }
+  static constexpr int block_size = 64;
+
+  ocean_engine() { seed( ((std::uint64_t)std::random_device{}() << 32) | std::random_device{}() ); }
+  explicit ocean_engine( std::uint64_t s ) { seed(s); }
+
+  void seed( std::uint64_t s ) {
+    // The state is four SplitMix64 outputs, never all zero
+    for ( auto &word : state ) { word = splitmix64(s); s += 0x9e3779b97f4a7c15ULL; }
+    next = block_size;
+    bits_left = 0;
+  } // End seeding the engine
+
+  result_type operator () () {
+    if ( next == block_size ) { refill(); }
+    return block[next++];
+  } // End drawing a word
+
+  int direction() {
+    // Uniform 0..7, sliced off a word 3 bits at a time
+    if ( bits_left < 3 ) {
+      bits = (*this)();
+      bits_left = 63; // 21 slices of the 64 bits
+    }
+    int d = bits & 7;
+    bits >>= 3;
+    bits_left -= 3;
+    return d;
+  } // End drawing a direction
+
+  std::uint64_t below( std::uint64_t s ) {
+    // Uniform 0..s-1 for s > 0 (Lemire, "Fast random integer generation in an interval")
+    unsigned __int128 m = (unsigned __int128)(*this)() * s;
+    std::uint64_t low = (std::uint64_t)m;
+    if ( low < s ) {
+      std::uint64_t threshold = -s % s;
+      while ( low < threshold ) {
+	m = (unsigned __int128)(*this)() * s;
+	low = (std::uint64_t)m;
+      } // End rejecting the biased draws
+    }
+    return m >> 64;
+  } // End drawing a bounded integer
+
+  double uniform() { return ((*this)() >> 11) * 0x1.0p-53; }
+
+  double exponential( double rate ) { return -std::log1p(-uniform())/rate; } // Waiting time at this rate
+
+  template <class iter_t>
+  void shuffle( iter_t first , iter_t last ) {
+    // Fisher-Yates with below() for the swaps
+    for ( auto k = std::distance(first,last) ; k > 1 ; k-- ) {
+      std::swap( first[k-1] , first[below(k)] );
+    } // End loop over the range
+  } // End shuffling a range
+private:
+  std::array<std::uint64_t,4> state;
+  std::array<std::uint64_t,block_size> block;
+  int next{block_size};
+  std::uint64_t bits{0};
+  int bits_left{0};
+
+  static std::uint64_t rotl( std::uint64_t x , int k ) { return (x << k) | (x >> (64-k)); }
+
+  void refill() {
+    // The state lives in locals for the loop so it stays in registers
+    auto [s0,s1,s2,s3] = state;
+    for ( int k=0 ; k<block_size ; k++ ) {
+      block[k] = rotl(s0+s3,23) + s0;
+      std::uint64_t t = s1 << 17;
+      s2 ^= s0;
+      s3 ^= s1;
+      s1 ^= s2;
+      s0 ^= s3;
+      s2 ^= t;
+      s3 = rotl(s3,45);
+    } // End loop over the block
+    state = {s0,s1,s2,s3};
+    next = 0;
+  } // End refilling the block
+}; // End of ocean engine class
+
+inline ocean_engine& engine() {
+  // One engine per thread (inline, so every translation unit shares it), so
+  // parallel workers neither share a stream nor contend for it
+  static thread_local ocean_engine g;
   return g;
 }
+
+inline std::uint64_t simulation_seed( std::uint64_t master , std::uint64_t index ) {
+  // Seed of simulation index of an ensemble, so each one can be rerun on its own
+  return splitmix64( splitmix64(master) + index );
+}
+
+inline void seed_engine( std::uint64_t seed ) { engine().seed(seed); }
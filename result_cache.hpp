@@ -0,0 +1,90 @@
+#pragma once // Guard multiple instances
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <random>
+
+struct sim_outcome {
+  // What is left at the end of one simulation
+  std::int64_t turtles , ships , garbage , sardines;
+};
+
+class result_cache {
+  // Ensemble outcomes saved on disk under a hash of everything that decides
+  // them: the options that change a simulation, the master seed and the
+  // engine version. The key text is also stored in the file and checked on
+  // load, so a hash collision reads as a miss.
+  // Simulation i of an ensemble is seeded from (master seed, i) alone, so a
+  // cached ensemble of N simulations is the first N of any bigger one with
+  // the same key, and a request for more only has to run the extra ones.
+  // Files are written to a temporary name of their own (so runs sharing the
+  // directory never write into each other's) and renamed, and they end with
+  // a line holding the number of outcomes, so an interrupted or cut off
+  // file reads as a miss rather than as fewer or wrong outcomes.
+private:
+  std::filesystem::path dir;
+public:
+  result_cache( const std::string &directory ) : dir(directory) {};
+
+  static std::uint64_t fnv1a( const std::string &text ) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for ( unsigned char c : text ) {
+      h ^= c;
+      h *= 0x100000001b3ULL;
+    } // End loop over characters
+    return h;
+  } // End hashing a string
+
+  std::filesystem::path path_for( const std::string &key ) {
+    char name[32];
+    std::snprintf(name,sizeof(name),"%016llx.txt",(unsigned long long)fnv1a(key));
+    return dir / name;
+  } // End finding the file of a key
+
+  std::vector<sim_outcome> load( const std::string &key ) {
+    // Outcomes saved under key, empty on a miss
+    std::ifstream file(path_for(key));
+    if ( !file ) { return {}; }
+    std::string line , stored_key;
+    while ( std::getline(file,line) && line != "outcomes" ) { stored_key += line + '\n'; }
+    if ( stored_key != key ) { return {}; } // Different options with the same hash
+    std::vector<sim_outcome> outcomes;
+    while ( std::getline(file,line) ) {
+      std::istringstream fields(line);
+      std::string end;
+      std::size_t count;
+      if ( line.rfind("end ",0) == 0 ) {
+	if ( fields >> end >> count && count == outcomes.size() ) { return outcomes; }
+	return {};
+      } // Done, if every outcome made it
+      sim_outcome o;
+      if ( !(fields >> o.turtles >> o.ships >> o.garbage >> o.sardines) ) { return {}; }
+      outcomes.push_back(o);
+    } // End loop over outcomes
+    return {}; // No end line, so the file was cut off
+  } // End loading outcomes
+
+  void store( const std::string &key , const std::vector<sim_outcome> &outcomes ) {
+    std::filesystem::create_directories(dir);
+    std::filesystem::path path = path_for(key) , temporary = path;
+    char suffix[40];
+    std::snprintf(suffix,sizeof(suffix),".%016llx.tmp",
+		  (unsigned long long)(((std::uint64_t)std::random_device{}() << 32) | std::random_device{}()));
+    temporary += suffix; // Unique, so concurrent runs with the same key do not share it
+    {
+      std::ofstream file(temporary);
+      if (!file) throw std::runtime_error("Could not write to the result cache in "+dir.string());
+      file << key << "outcomes\n";
+      for ( auto &o : outcomes ) { file << o.turtles << ' ' << o.ships << ' ' << o.garbage << ' ' << o.sardines << '\n'; }
+      file << "end " << outcomes.size() << '\n';
+      if (!file) throw std::runtime_error("Could not write to the result cache in "+dir.string());
+    } // Done writing the file
+    std::filesystem::rename(temporary,path);
+  } // End storing outcomes
+}; // End of result cache class
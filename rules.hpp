@@ -0,0 +1,81 @@
+#pragma once // Guard multiple instances
+
+#include <array>
+#include <cstdint>
+
+// Define our enum class which holds the values a cell may hold
+// One byte each, so a cell is one byte and a 64x64 tile is one 4 KiB page
+enum class cell_type : std::uint8_t { water_only=0 , turtle=1 , ship=2 , garbage=3 };
+
+constexpr int n_cell_types = 4;
+
+// What happens when something moves, besides the cells changing
+enum class move_event : std::uint8_t {
+  none ,
+  turtle_dies ,     // A turtle moved onto garbage
+  garbage_picked_up // A ship moved onto garbage
+};
+
+struct move_rule {
+  bool allowed{false};                   // Whether the mover may go there
+  cell_type result{cell_type::water_only}; // What the destination becomes
+  move_event event{move_event::none};
+};
+
+// The interaction rules as a table, looked up by
+//   move_rules[mover][last destination][current destination]
+// where the last destination is the cell in the grid being updated from and
+// the current one is the cell in the grid being written (they are the same
+// grid for the kinetic Monte Carlo model). The cell the mover leaves becomes
+// water. The rules are:
+//   - ships and turtles never move onto a ship or turtle, in either grid
+//   - a turtle moving onto garbage dies and the garbage stays
+//   - a ship moving onto garbage picks it up
+//   - garbage (pushed by currents) never moves onto garbage
+// A new species or rule variant is a new cell_type and its rows here; only
+// its events need code, in grid_2d::random_motion.
+constexpr auto make_move_rules() {
+  std::array<std::array<std::array<move_rule,n_cell_types>,n_cell_types>,n_cell_types> rules{};
+  auto is_agent = []( cell_type t ) { return t == cell_type::ship || t == cell_type::turtle; };
+  for ( int m=0 ; m<n_cell_types ; m++ ) {
+    for ( int l=0 ; l<n_cell_types ; l++ ) {
+      for ( int d=0 ; d<n_cell_types ; d++ ) {
+	cell_type mover = static_cast<cell_type>(m) , last = static_cast<cell_type>(l) , dest = static_cast<cell_type>(d);
+	move_rule &r = rules[m][l][d];
+	switch ( mover ) {
+	case cell_type::water_only :
+	  r = { true , dest , move_event::none }; // Water never moves, random_motion skips it
+	  break;
+	case cell_type::garbage :
+	  r = { last != cell_type::garbage && dest != cell_type::garbage , cell_type::garbage , move_event::none };
+	  break;
+	case cell_type::turtle :
+	  r = { !is_agent(last) && !is_agent(dest) ,
+		dest == cell_type::garbage ? cell_type::garbage : cell_type::turtle ,
+		dest == cell_type::garbage ? move_event::turtle_dies : move_event::none };
+	  break;
+	case cell_type::ship :
+	  r = { !is_agent(last) && !is_agent(dest) , cell_type::ship ,
+		dest == cell_type::garbage ? move_event::garbage_picked_up : move_event::none };
+	  break;
+	} // End the rules for this mover
+      } // End loop over current destinations
+    } // End loop over last destinations
+  } // End loop over movers
+  return rules;
+} // End making the rule table
+
+inline constexpr auto move_rules = make_move_rules();
+
+constexpr const move_rule& rule_for( cell_type mover , cell_type last , cell_type dest ) {
+  return move_rules[ static_cast<int>(mover) ][ static_cast<int>(last) ][ static_cast<int>(dest) ];
+} // End looking up a rule
+
+constexpr bool moves_itself( cell_type t ) { return t == cell_type::ship || t == cell_type::turtle; } // Garbage only drifts with the currents
+
+// The table says what the old switch statements did
+static_assert( !rule_for(cell_type::turtle,cell_type::water_only,cell_type::ship).allowed );
+static_assert( !rule_for(cell_type::ship,cell_type::turtle,cell_type::water_only).allowed );
+static_assert( rule_for(cell_type::turtle,cell_type::water_only,cell_type::garbage).result == cell_type::garbage );
+static_assert( rule_for(cell_type::ship,cell_type::garbage,cell_type::garbage).event == move_event::garbage_picked_up );
+static_assert( !rule_for(cell_type::garbage,cell_type::garbage,cell_type::water_only).allowed );
@@ -0,0 +1,147 @@
+#pragma once // Guard multiple instances
+
+#include "grid.hpp"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+class sardine_field {
+  // Sardines as a density (sardines per cell) living alongside the grid.
+  // Each update the turtles eat, the sardines reproduce and then they diffuse:
+  //   1. every turtle eats a fraction rate_of_eating of the sardines in each
+  //      cell of its 3x3 neighborhood, so a cell with k turtles around it keeps
+  //      (1-rate_of_eating)^k of its sardines
+  //   2. the rest grow by rate_of_birth, logistically if a carrying capacity is set
+  //   3. the density diffuses with a 5 or 9 point stencil and no flux through the edges
+  // Both passes walk the grid in column tiles so the three rows a stencil
+  // needs stay in cache, and the inner loops are plain float loops that
+  // the compiler can vectorize.
+private:
+  int m{0} , n{0};
+  double initial_total{0.0}; // Total population before the field is first used
+  vector<float> density , reacted; // Sardines per cell, and after eating and growth
+  vector<float> turtles , row_sums; // Turtle mask and its 1x3 box sums
+public:
+  static constexpr int tile = 512; // Columns handled per block
+
+  double diffusion{0.1}; // Fraction moving to the neighbors each update
+  int stencil{5};        // 5 or 9 point Laplacian
+  double capacity{0.0};  // Carrying capacity per cell, 0 for unlimited growth
+
+  sardine_field() = default;
+  sardine_field( int m , int n , double total ) : m(m) , n(n) , initial_total(total) {};
+
+  bool allocated() { return !density.empty(); }
+
+  void reset( double total ) {
+    // Back to an even spread of total sardines, keeping the buffers
+    initial_total = total;
+    if ( allocated() ) { std::fill(density.begin(),density.end(),(float)(total/density.size())); }
+  } // End resetting the field
+
+  void allocate() {
+    // Spread the starting population evenly over the grid
+    std::size_t cells = (std::size_t)m*n;
+    density.assign(cells,(float)(initial_total/cells));
+    reacted.resize(cells);
+    turtles.resize(cells);
+    row_sums.resize(cells);
+  } // End allocating the field
+
+  double total() {
+    if ( !allocated() ) { return initial_total; }
+    return std::accumulate(density.begin(),density.end(),0.0);
+  } // End summing the sardines
+
+  float at( int i , int j ) {
+    if ( !allocated() ) { return initial_total/((double)m*n); }
+    return density.at((std::size_t)i*n+j);
+  } // End getting the density in one cell
+
+  void update( grid_2d &g , double rate_of_birth , double rate_of_eating ) {
+    if ( stencil != 5 && stencil != 9 ) throw std::runtime_error("Sardine stencil must be 5 or 9 points.");
+    if ( !allocated() ) { allocate(); }
+    mark_turtles(g);
+    eat_and_grow(rate_of_birth,rate_of_eating);
+    diffuse();
+  } // End updating the sardines
+
+private:
+  void mark_turtles( grid_2d &g ) {
+    // 1 where there is a turtle, then sums over each cell and its left and right neighbors
+    for (int i=0 ; i<m ; i++) {
+      float *mask = turtles.data()+(std::size_t)i*n;
+      for (int j=0 ; j<n ; j++) { mask[j] = ( g.get_cell_type(i,j) == cell_type::turtle ); }
+      float *sums = row_sums.data()+(std::size_t)i*n;
+      sums[0] = mask[0] + ( n>1 ? mask[1] : 0.f );
+      for (int j=1 ; j<n-1 ; j++) { sums[j] = mask[j-1]+mask[j]+mask[j+1]; }
+      if ( n>1 ) { sums[n-1] = mask[n-2]+mask[n-1]; }
+    } // End loop over rows
+  } // End marking the turtles
+
+  void eat_and_grow( double rate_of_birth , double rate_of_eating ) {
+    const float log_kept = std::log( std::max(1e-30,1.0-std::clamp(rate_of_eating,0.0,1.0)) );
+    const float birth = rate_of_birth;
+    const float growth = rate_of_birth-1.0;
+    const float inv_capacity = capacity>0 ? 1.0/capacity : 0.f;
+    const bool logistic = capacity>0;
+    for (int j0=0 ; j0<n ; j0+=tile) {
+      int width = std::min(n,j0+tile)-j0;
+      for (int i=0 ; i<m ; i++) {
+	const float *up = row_sums.data()+(std::size_t)std::max(i-1,0)*n+j0;
+	const float *mid = row_sums.data()+(std::size_t)i*n+j0;
+	const float *down = row_sums.data()+(std::size_t)std::min(i+1,m-1)*n+j0;
+	const float *s = density.data()+(std::size_t)i*n+j0;
+	float *out = reacted.data()+(std::size_t)i*n+j0;
+	float top = i>0 ? 1.f : 0.f , bottom = i<m-1 ? 1.f : 0.f; // Rows past the edge have no turtles
+	for (int k=0 ; k<width ; k++) {
+	  float eaters = top*up[k] + mid[k] + bottom*down[k];
+	  float left = s[k]*std::exp(eaters*log_kept);
+	  out[k] = logistic ? left + growth*left*(1.f-left*inv_capacity) : left*birth;
+	  out[k] = std::max(out[k],0.f);
+	} // End loop over the tile
+      } // End loop over rows
+    } // End loop over column tiles
+  } // End eating and growing
+
+  void diffuse() {
+    // Explicit step of ds = D * Laplacian(s), edges reflect so no sardines are lost
+    const float d = std::clamp(diffusion,0.0,stencil==5 ? 0.25 : 0.3);
+    for (int j0=0 ; j0<n ; j0+=tile) {
+      int j1 = std::min(n,j0+tile);
+      for (int i=0 ; i<m ; i++) {
+	const float *up = reacted.data()+(std::size_t)std::max(i-1,0)*n;
+	const float *mid = reacted.data()+(std::size_t)i*n;
+	const float *down = reacted.data()+(std::size_t)std::min(i+1,m-1)*n;
+	float *out = density.data()+(std::size_t)i*n;
+	// Edge columns use the cell itself in place of the missing neighbor
+	int first = std::max(j0,1) , last = std::min(j1,n-1);
+	for (int j=j0 ; j<first ; j++) { out[j] = stencil_at(up,mid,down,j,d); }
+	if ( stencil == 5 ) {
+	  for (int j=first ; j<last ; j++) {
+	    out[j] = mid[j] + d*( up[j]+down[j]+mid[j-1]+mid[j+1] - 4.f*mid[j] );
+	  } // End five point interior
+	}
+	else {
+	  for (int j=first ; j<last ; j++) {
+	    float sides = up[j]+down[j]+mid[j-1]+mid[j+1];
+	    float corners = up[j-1]+up[j+1]+down[j-1]+down[j+1];
+	    out[j] = mid[j] + d*( 4.f*sides + corners - 20.f*mid[j] )/6.f;
+	  } // End nine point interior
+	}
+	for (int j=std::max(last,first) ; j<j1 ; j++) { out[j] = stencil_at(up,mid,down,j,d); }
+      } // End loop over rows
+    } // End loop over column tiles
+  } // End diffusing
+
+  float stencil_at( const float *up , const float *mid , const float *down , int j , float d ) {
+    // Stencil for an edge column, clamping the column index into the grid
+    int l = std::max(j-1,0) , r = std::min(j+1,n-1);
+    float sides = up[j]+down[j]+mid[l]+mid[r];
+    if ( stencil == 5 ) { return mid[j] + d*( sides - 4.f*mid[j] ); }
+    float corners = up[l]+up[r]+down[l]+down[r];
+    return mid[j] + d*( 4.f*sides + corners - 20.f*mid[j] )/6.f;
+  } // End the stencil at an edge column
+}; // End of sardine field class
@@ -0,0 +1,193 @@
+// End to end scaling of the simulator: runs whole ensembles of
+// ocean::simulate on a pool of worker threads, the way main does, and
+// reports how throughput changes with the thread count, ocean size and
+// density of ships, turtles and garbage.
+//   strong scaling: the same ensemble spread over more threads,
+//                   efficiency = time(1 thread)/(threads*time)
+//   weak scaling:   sims_per_thread simulations for every thread,
+//                   efficiency = time(1 thread)/time
+// Results are written as CSV, or JSON if the output ends in .json.
+//
+// Usage: scaling [--threads 1,2,4] [--sizes 20,64,256] [--densities 0.01,0.1,0.3]
+//                [--sims 256] [--timesteps 50] [--mode strong|weak|both]
+//                [--affinity none] [--smart 0] [--model sweep|kmc] [--seed 322] [--out scaling.csv]
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include "ocean.hpp"
+#include "kmc_ocean.hpp"
+#include "thread_placement.hpp"
+
+struct scaling_config {
+  std::vector<int> threads;
+  std::vector<int> sizes = { 20 , 64 , 256 };
+  std::vector<double> densities = { 0.01 , 0.1 , 0.3 };
+  int sims = 256; // Ensemble size for strong scaling, per thread for weak scaling
+  int timesteps = 50;
+  std::string mode = "both";
+  std::string affinity = "none";
+  bool smart = false;
+  std::string model = "sweep";
+  std::uint64_t seed = 322;
+  std::string out = "scaling.csv";
+};
+
+struct scaling_result {
+  std::string mode;
+  int threads , size;
+  double density;
+  int sims , timesteps;
+  double seconds;
+  double cells_per_second , sims_per_second;
+  double efficiency; // Relative to one thread of the same case
+};
+
+template <class value_t>
+std::vector<value_t> parse_list( const std::string &text ) {
+  std::vector<value_t> values;
+  std::stringstream ss(text);
+  std::string part;
+  while ( std::getline(ss,part,',') ) { values.push_back( (value_t)std::stod(part) ); }
+  return values;
+} // End parsing a comma separated list
+
+double run_ensemble( const scaling_config &cfg , int n_threads , int size , double density , int n_sims ) {
+  // Wall time of n_sims simulations on n_threads workers, each reusing one ocean
+  long long occupied = density*size*size;
+  int ships = std::max(1LL,occupied/5);
+  int turtles = 2*occupied/5;
+  int garbage = std::max(0LL,occupied-ships-turtles);
+  std::vector<worker_placement> placement = plan_placement(cfg.affinity,n_threads);
+  std::atomic<int> next_sim{0};
+  std::mutex failure_lock;
+  std::exception_ptr failure;
+
+  auto work = [&]( int w ) {
+    pin_this_thread(placement[w].cpu);
+    try {
+      std::unique_ptr<ocean> simulation;
+      for ( int i=next_sim++ ; i<n_sims ; i=next_sim++ ) {
+	seed_engine(simulation_seed(cfg.seed,i));
+	if ( simulation ) { simulation->reset(100); }
+	else if ( cfg.model == "kmc" ) { simulation = std::make_unique<kmc_ocean>(size,size,100); }
+	else { simulation = std::make_unique<ocean>(size,size,100); }
+	simulation->initiate_grid(ships,turtles,garbage);
+	simulation->simulate(cfg.timesteps,1.0,5,cfg.smart,false,false,1.0,0.0);
+      } // End loop over simulations
+    } catch ( ... ) {
+      std::lock_guard<std::mutex> guard(failure_lock);
+      if ( !failure ) { failure = std::current_exception(); }
+      next_sim = n_sims; // Stop the other workers
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for ( int w=1 ; w<n_threads ; w++ ) { workers.emplace_back(work,w); }
+  work(0);
+  for ( auto &t : workers ) { t.join(); }
+  if ( failure ) { std::rethrow_exception(failure); }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+} // End running one ensemble
+
+void write_results( const std::string &path , const std::vector<scaling_result> &results ) {
+  std::ofstream file(path);
+  if (!file) throw std::runtime_error("Could not open "+path+" for writing.");
+  bool json = path.size() >= 5 && path.substr(path.size()-5) == ".json";
+  if ( json ) { file << "{\n  \"scaling\": [\n"; }
+  else { file << "mode,threads,size,density,sims,timesteps,seconds,cells_per_second,sims_per_second,efficiency\n"; }
+  for ( std::size_t k=0 ; k<results.size() ; k++ ) {
+    auto &r = results[k];
+    if ( json ) {
+      file << "    { \"mode\": \"" << r.mode << "\", \"threads\": " << r.threads << ", \"size\": " << r.size
+	   << ", \"density\": " << r.density << ", \"sims\": " << r.sims << ", \"timesteps\": " << r.timesteps
+	   << ", \"seconds\": " << r.seconds << ", \"cells_per_second\": " << r.cells_per_second
+	   << ", \"sims_per_second\": " << r.sims_per_second << ", \"efficiency\": " << r.efficiency << " }"
+	   << ( k+1<results.size() ? ",\n" : "\n" );
+    }
+    else {
+      file << r.mode << ',' << r.threads << ',' << r.size << ',' << r.density << ',' << r.sims << ',' << r.timesteps << ','
+	   << r.seconds << ',' << r.cells_per_second << ',' << r.sims_per_second << ',' << r.efficiency << '\n';
+    }
+  } // End loop over results
+  if ( json ) { file << "  ]\n}\n"; }
+} // End writing the results
+
+int main( int argc , char **argv ) {
+  scaling_config cfg;
+  for ( int t=1 ; t<=(int)allowed_cpus().size() ; t*=2 ) { cfg.threads.push_back(t); }
+  for ( int a=1 ; a+1<argc ; a+=2 ) {
+    std::string flag = argv[a];
+    if      ( flag == "--threads" )   { cfg.threads = parse_list<int>(argv[a+1]); }
+    else if ( flag == "--sizes" )     { cfg.sizes = parse_list<int>(argv[a+1]); }
+    else if ( flag == "--densities" ) { cfg.densities = parse_list<double>(argv[a+1]); }
+    else if ( flag == "--sims" )      { cfg.sims = std::max(1,std::atoi(argv[a+1])); }
+    else if ( flag == "--timesteps" ) { cfg.timesteps = std::atoi(argv[a+1]); }
+    else if ( flag == "--mode" )      { cfg.mode = argv[a+1]; }
+    else if ( flag == "--affinity" )  { cfg.affinity = argv[a+1]; }
+    else if ( flag == "--smart" )     { cfg.smart = std::atoi(argv[a+1]) != 0; }
+    else if ( flag == "--model" )     { cfg.model = argv[a+1]; }
+    else if ( flag == "--seed" )      { cfg.seed = std::strtoull(argv[a+1],nullptr,10); }
+    else if ( flag == "--out" )       { cfg.out = argv[a+1]; }
+    else { std::cerr << "Unknown option " << flag << '\n'; return 1; }
+  } // End reading the options
+  if ( cfg.mode != "strong" && cfg.mode != "weak" && cfg.mode != "both" ) { std::cerr << "Unknown mode " << cfg.mode << '\n'; return 1; }
+  if ( cfg.model != "sweep" && cfg.model != "kmc" ) { std::cerr << "Unknown model " << cfg.model << '\n'; return 1; }
+  for ( double density : cfg.densities ) {
+    if ( density < 0.0 || density > 1.0 ) { std::cerr << "Densities are fractions of the cells, from 0 to 1, not " << density << '\n'; return 1; }
+  } // End checking the densities
+  for ( int size : cfg.sizes ) {
+    if ( size < 1 ) { std::cerr << "Sizes must be positive, not " << size << '\n'; return 1; }
+  } // End checking the sizes
+  if ( std::find(cfg.threads.begin(),cfg.threads.end(),1) == cfg.threads.end() ) { cfg.threads.insert(cfg.threads.begin(),1); } // Baseline
+  std::sort(cfg.threads.begin(),cfg.threads.end());
+
+  std::vector<std::string> modes;
+  if ( cfg.mode != "weak" ) { modes.push_back("strong"); }
+  if ( cfg.mode != "strong" ) { modes.push_back("weak"); }
+
+  std::vector<scaling_result> results;
+  std::cout << std::setprecision(4);
+  std::cout << "mode    threads  size  density    sims   seconds  Mcells/s      sims/s  efficiency\n";
+  for ( auto &mode : modes ) {
+    for ( int size : cfg.sizes ) {
+      for ( double density : cfg.densities ) {
+	double base_seconds = 0.0;
+	for ( int threads : cfg.threads ) {
+	  if ( threads < 1 ) { continue; }
+	  int sims = mode == "strong" ? cfg.sims : cfg.sims*threads;
+	  double seconds;
+	  try { seconds = run_ensemble(cfg,threads,size,density,sims); }
+	  catch ( const std::exception &e ) { std::cerr << "Simulation failed: " << e.what() << '\n'; return 1; }
+	  if ( threads == 1 ) { base_seconds = seconds; }
+	  scaling_result r{ .mode = mode , .threads = threads , .size = size , .density = density ,
+			    .sims = sims , .timesteps = cfg.timesteps , .seconds = seconds ,
+			    .cells_per_second = (double)sims*cfg.timesteps*size*size/seconds ,
+			    .sims_per_second = sims/seconds ,
+			    .efficiency = mode == "strong" ? base_seconds/(threads*seconds) : base_seconds/seconds };
+	  std::cout << std::left << std::setw(8) << mode << std::right << std::setw(7) << threads << std::setw(6) << size
+		    << std::setw(9) << density << std::setw(8) << sims << std::setw(10) << seconds
+		    << std::setw(10) << r.cells_per_second/1e6 << std::setw(12) << r.sims_per_second
+		    << std::setw(12) << r.efficiency << '\n';
+	  results.push_back(r);
+	} // End loop over thread counts
+      } // End loop over densities
+    } // End loop over sizes
+  } // End loop over modes
+
+  write_results(cfg.out,results);
+  std::cout << "Wrote " << results.size() << " results to " << cfg.out << '\n';
+  return 0;
+} // End of main
@@ -0,0 +1,94 @@
+#pragma once // Guard multiple instances
+
+// sim_generator<ref_t> is std::generator<ref_t> where the standard library
+// has it (C++23 <generator>), and otherwise a minimal coroutine generator
+// with the parts of its interface the ocean uses: a lazy input range that
+// runs the coroutine up to each co_yield as it is iterated, and stops it
+// (destroying its frame) when the generator goes away.
+
+#include <version>
+#if __has_include(<generator>)
+#include <generator>
+#endif
+
+#if defined(__cpp_lib_generator)
+
+template <class ref_t>
+using sim_generator = std::generator<ref_t>;
+
+#else
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+template <class ref_t>
+class sim_generator {
+  // Yields references to values living in the coroutine frame, so co_yield
+  // never copies. The reference stays valid until the next increment.
+  using value_t = std::remove_cvref_t<ref_t>;
+public:
+  struct promise_type {
+    const value_t *current{nullptr};
+    std::exception_ptr error;
+
+    sim_generator get_return_object() { return sim_generator( std::coroutine_handle<promise_type>::from_promise(*this) ); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value( const value_t &v ) noexcept {
+      current = std::addressof(v);
+      return {};
+    } // Temporaries in a co_yield live until the coroutine resumes
+    void return_void() {}
+    void unhandled_exception() { error = std::current_exception(); }
+  };
+
+  class iterator {
+  private:
+    std::coroutine_handle<promise_type> h;
+  public:
+    using value_type = value_t;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator( std::coroutine_handle<promise_type> h ) : h(h) {};
+
+    ref_t operator * () const { return static_cast<ref_t>( const_cast<value_t&>(*h.promise().current) ); }
+
+    iterator& operator ++ () {
+      h.resume();
+      if ( h.promise().error ) { std::rethrow_exception(h.promise().error); }
+      return *this;
+    }
+    void operator ++ ( int ) { ++*this; }
+
+    bool operator == ( std::default_sentinel_t ) const { return !h || h.done(); }
+  };
+
+  sim_generator( sim_generator &&other ) noexcept : h(std::exchange(other.h,{})) {};
+  sim_generator& operator = ( sim_generator &&other ) noexcept {
+    if ( this != &other ) {
+      if ( h ) { h.destroy(); }
+      h = std::exchange(other.h,{});
+    }
+    return *this;
+  }
+  ~sim_generator() { if ( h ) { h.destroy(); } }
+
+  iterator begin() {
+    // Runs up to the first co_yield
+    h.resume();
+    if ( h.promise().error ) { std::rethrow_exception(h.promise().error); }
+    return iterator(h);
+  }
+  std::default_sentinel_t end() { return {}; }
+private:
+  std::coroutine_handle<promise_type> h;
+
+  explicit sim_generator( std::coroutine_handle<promise_type> h ) : h(h) {};
+}; // End of generator class
+
+#endif
@@ -0,0 +1,121 @@
+#pragma once // Guard multiple instances
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <ostream>
+
+// Event counters and phase timers for the simulation core.
+// Build with -DOCEAN_STATS=0 to compile all of the counting and timing out.
+#ifndef OCEAN_STATS
+#define OCEAN_STATS 1
+#endif
+
+// The parts of a time step that get their own wall clock timer
+enum class sim_phase { garbage_copy=0 , motion_sweep=1 , grid_copy=2 , reproduction=3 };
+inline constexpr int n_sim_phases = 4;
+
+inline const char* phase_name( sim_phase p ) {
+  static constexpr const char *names[n_sim_phases] = { "garbage_copy" , "motion_sweep" , "grid_copy" , "reproduction" };
+  return names[ static_cast<int>(p) ];
+} // End getting the name of a phase
+
+struct sim_counters {
+  long long move_attempts{0};   // Random cells tried in get_valid_random_move
+  long long move_rejections{0}; // Tries that were not a valid move
+  long long stuck_agents{0};    // Agents that stayed put after 100 tries
+  long long turtle_deaths{0};   // Turtles that moved onto garbage
+  long long garbage_pickups{0}; // Garbage collected by ships
+  long long smart_ship_hits{0}; // Smart ships that found garbage next to them
+  long long turtle_births{0};   // Turtles placed by reproduce_turtles
+  double phase_seconds[n_sim_phases]{};
+  long long phase_calls[n_sim_phases]{};
+
+  void add( const sim_counters &other ) {
+    move_attempts += other.move_attempts;
+    move_rejections += other.move_rejections;
+    stuck_agents += other.stuck_agents;
+    turtle_deaths += other.turtle_deaths;
+    garbage_pickups += other.garbage_pickups;
+    smart_ship_hits += other.smart_ship_hits;
+    turtle_births += other.turtle_births;
+    for (int p=0 ; p<n_sim_phases ; p++) {
+      phase_seconds[p] += other.phase_seconds[p];
+      phase_calls[p] += other.phase_calls[p];
+    } // End loop over phases
+  } // End adding another set of counters to this one
+
+  void write_json( std::ostream &os ) const {
+    os << "{\n"
+       << "    \"move_attempts\": " << move_attempts << ",\n"
+       << "    \"move_rejections\": " << move_rejections << ",\n"
+       << "    \"stuck_agents\": " << stuck_agents << ",\n"
+       << "    \"turtle_deaths\": " << turtle_deaths << ",\n"
+       << "    \"garbage_pickups\": " << garbage_pickups << ",\n"
+       << "    \"smart_ship_hits\": " << smart_ship_hits << ",\n"
+       << "    \"turtle_births\": " << turtle_births << ",\n"
+       << "    \"phases\": {\n";
+    for (int p=0 ; p<n_sim_phases ; p++) {
+      os << "      \"" << phase_name(static_cast<sim_phase>(p)) << "\": { \"seconds\": " << phase_seconds[p]
+	 << ", \"calls\": " << phase_calls[p] << " }" << ( p+1<n_sim_phases ? ",\n" : "\n" );
+    } // End loop over phases
+    os << "    }\n  }";
+  } // End writing the counters as json
+}; // End of sim counters
+
+class stats_registry {
+  // Every thread counts into its own sim_counters, so counting needs no locks.
+  // The registry owns them so they can be merged after the threads are done.
+private:
+  std::mutex lock;
+  std::vector<std::unique_ptr<sim_counters>> per_thread;
+public:
+  sim_counters* add_thread() {
+    std::lock_guard<std::mutex> guard(lock);
+    per_thread.push_back( std::make_unique<sim_counters>() );
+    return per_thread.back().get();
+  } // End adding counters for a new thread
+
+  sim_counters total() {
+    std::lock_guard<std::mutex> guard(lock);
+    sim_counters sum;
+    for ( auto &c : per_thread ) { sum.add(*c); }
+    return sum;
+  } // End merging all threads
+}; // End of stats registry
+
+inline stats_registry& stats() {
+  static stats_registry registry;
+  return registry;
+} // End getting the global registry
+
+inline sim_counters& counters() {
+  thread_local sim_counters *mine = stats().add_thread();
+  return *mine;
+} // End getting this thread's counters
+
+#if OCEAN_STATS
+#define STAT_ADD(field,amount) ( counters().field += (amount) )
+
+class phase_timer {
+  // Adds the time between construction and destruction to a phase
+private:
+  sim_phase phase;
+  std::chrono::steady_clock::time_point start;
+public:
+  phase_timer( sim_phase p ) : phase(p) , start(std::chrono::steady_clock::now()) {};
+  ~phase_timer() {
+    int p = static_cast<int>(phase);
+    counters().phase_seconds[p] += std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    counters().phase_calls[p]++;
+  }
+}; // End of phase timer
+#else
+#define STAT_ADD(field,amount) ( (void)0 )
+
+class phase_timer {
+public:
+  phase_timer( sim_phase ) {};
+}; // End of (empty) phase timer
+#endif
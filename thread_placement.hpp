@@ -0,0 +1,125 @@
+#pragma once // Guard multiple instances
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+// Where the worker threads of a parallel ensemble run. Workers are pinned to
+// CPUs by an --affinity policy, and since every worker builds its own oceans
+// after pinning itself, the grids, counts and sardine fields are first
+// touched, and so placed by the kernel, on that worker's NUMA node. The grid
+// tiles come from calloc'd slabs that stay untouched until a cell is
+// written, so they follow the worker that writes them as well.
+// NUMA nodes are read from /sys, no libnuma needed. Everything here is a no
+// op away from Linux.
+
+struct worker_placement {
+  int cpu{-1};  // -1 for not pinned
+  int node{-1}; // NUMA node of the cpu, -1 if unknown
+};
+
+inline std::vector<int> parse_cpu_list( const std::string &list ) {
+  // "0-3,8,10-11" as in /sys cpulist files and --affinity
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string part;
+  while ( std::getline(ss,part,',') ) {
+    if ( part.empty() || part == "\n" ) { continue; }
+    auto dash = part.find('-');
+    int first = std::stoi(part.substr(0,dash));
+    int last = dash == std::string::npos ? first : std::stoi(part.substr(dash+1));
+    for ( int c=first ; c<=last ; c++ ) { cpus.push_back(c); }
+  } // End loop over ranges
+  return cpus;
+} // End parsing a list of cpus
+
+inline std::vector<int> allowed_cpus() {
+  // The cpus this process may run on, in order
+  std::vector<int> cpus;
+#if defined(__linux__)
+  cpu_set_t set;
+  if ( sched_getaffinity(0,sizeof(set),&set) == 0 ) {
+    for ( int c=0 ; c<CPU_SETSIZE ; c++ ) { if ( CPU_ISSET(c,&set) ) { cpus.push_back(c); } }
+  }
+#endif
+  if ( cpus.empty() ) {
+    for ( int c=0 ; c<(int)std::max(1u,std::thread::hardware_concurrency()) ; c++ ) { cpus.push_back(c); }
+  }
+  return cpus;
+} // End listing the allowed cpus
+
+inline int cpu_node( int cpu ) {
+  // NUMA node a cpu belongs to, -1 if the system does not say
+  for ( int node=0 ; node<1024 ; node++ ) {
+    std::ifstream file("/sys/devices/system/node/node"+std::to_string(node)+"/cpulist");
+    if ( !file ) { return -1; }
+    std::string list;
+    std::getline(file,list);
+    auto cpus = parse_cpu_list(list);
+    if ( std::find(cpus.begin(),cpus.end(),cpu) != cpus.end() ) { return node; }
+  } // End loop over nodes
+  return -1;
+} // End finding the node of a cpu
+
+inline std::vector<worker_placement> plan_placement( const std::string &affinity , int n_workers ) {
+  // Cpu for each worker:
+  //   none     not pinned, the kernel moves workers around
+  //   compact  fill the allowed cpus in order, so workers share a node first
+  //   scatter  deal the workers out over the NUMA nodes in turn
+  //   0,2,4-7  these cpus, used round robin
+  std::vector<worker_placement> plan(n_workers);
+  if ( affinity == "none" ) { return plan; }
+
+  std::vector<int> cpus;
+  if ( affinity == "compact" || affinity == "scatter" ) { cpus = allowed_cpus(); }
+  else {
+    try { cpus = parse_cpu_list(affinity); }
+    catch ( const std::exception& ) { throw std::runtime_error("Unknown affinity "+affinity+", use none, compact, scatter or a list of cpus like 0,2,4-7."); }
+    if ( cpus.empty() ) throw std::runtime_error("No cpus in affinity "+affinity+".");
+  }
+
+  if ( affinity == "scatter" ) {
+    // Interleave the cpus of each node: first cpu of every node, then the second, ...
+    std::vector<std::vector<int>> by_node;
+    std::vector<int> nodes;
+    for ( int c : cpus ) {
+      int node = cpu_node(c);
+      auto it = std::find(nodes.begin(),nodes.end(),node);
+      if ( it == nodes.end() ) { nodes.push_back(node); by_node.push_back({}); it = nodes.end()-1; }
+      by_node[it-nodes.begin()].push_back(c);
+    } // End grouping the cpus by node
+    std::size_t total = cpus.size();
+    cpus.clear();
+    for ( std::size_t k=0 ; cpus.size() < total ; k++ ) {
+      for ( auto &v : by_node ) { if ( k < v.size() ) { cpus.push_back(v[k]); } }
+    } // End interleaving the nodes
+  }
+
+  for ( int w=0 ; w<n_workers ; w++ ) {
+    plan[w].cpu = cpus[w%cpus.size()];
+    plan[w].node = cpu_node(plan[w].cpu);
+  } // End loop over workers
+  return plan;
+} // End planning where the workers run
+
+inline bool pin_this_thread( int cpu ) {
+  // Pins the calling thread to one cpu, false if that is not possible
+#if defined(__linux__)
+  if ( cpu < 0 || cpu >= CPU_SETSIZE ) { return false; }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu,&set);
+  return pthread_setaffinity_np(pthread_self(),sizeof(set),&set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+} // End pinning the calling thread
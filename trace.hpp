@@ -0,0 +1,109 @@
+#pragma once // Guard multiple instances
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+// Timeline tracing of the simulation phases, written as Chrome trace JSON
+// (open it in chrome://tracing or ui.perfetto.dev). Tracing is off until
+// start_tracing() is called, and then each scope costs two clock reads.
+// Build with -DOCEAN_TRACE=0 to compile the scopes out entirely.
+#ifndef OCEAN_TRACE
+#define OCEAN_TRACE 1
+#endif
+
+struct trace_event {
+  const char *name; // Must be a string literal, we only keep the pointer
+  std::int64_t begin_ns , end_ns;
+};
+
+struct trace_buffer {
+  // Events of one thread. Only the owning thread writes to it, so no locking.
+  int tid;
+  std::vector<trace_event> events;
+  long long dropped{0}; // Events lost after the buffer was full
+};
+
+class trace_registry {
+private:
+  std::mutex lock; // Only taken when a thread registers or the trace is written
+  std::vector<std::unique_ptr<trace_buffer>> buffers;
+  std::chrono::steady_clock::time_point epoch{ std::chrono::steady_clock::now() };
+public:
+  std::atomic<bool> enabled{false};
+  std::size_t max_events_per_thread{1<<22};
+
+  trace_buffer* add_thread() {
+    std::lock_guard<std::mutex> guard(lock);
+    buffers.push_back( std::make_unique<trace_buffer>() );
+    buffers.back()->tid = buffers.size();
+    return buffers.back().get();
+  } // End adding a buffer for a new thread
+
+  std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-epoch).count();
+  } // End getting the time since the trace started
+
+  void write_chrome_trace( const std::string &path ) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error("Could not open "+path+" for writing.");
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    for ( auto &b : buffers ) {
+      file << ( first ? "" : ",\n" ) << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+	   << ",\"args\":{\"name\":\"worker " << b->tid << ( b->dropped ? " (events dropped)" : "" ) << "\"}}";
+      first = false;
+      for ( auto &e : b->events ) {
+	file << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid
+	     << ",\"ts\":" << e.begin_ns/1000.0 << ",\"dur\":" << (e.end_ns-e.begin_ns)/1000.0 << "}";
+      } // End loop over events
+    } // End loop over threads
+    file << "\n]}\n";
+  } // End writing the trace
+}; // End of trace registry
+
+inline trace_registry& tracer() {
+  static trace_registry registry;
+  return registry;
+} // End getting the global tracer
+
+inline trace_buffer& trace_thread_buffer() {
+  thread_local trace_buffer *mine = tracer().add_thread();
+  return *mine;
+} // End getting this thread's buffer
+
+inline void start_tracing() { tracer().enabled.store(true,std::memory_order_relaxed); }
+
+class trace_scope {
+  // Records one complete event from construction to destruction
+private:
+  const char *name;
+  std::int64_t begin_ns{-1};
+public:
+  trace_scope( const char *event_name ) : name(event_name) {
+    if ( tracer().enabled.load(std::memory_order_relaxed) ) { begin_ns = tracer().now_ns(); }
+  }
+  ~trace_scope() {
+    if ( begin_ns < 0 ) { return; }
+    trace_buffer &b = trace_thread_buffer();
+    if ( b.events.size() >= tracer().max_events_per_thread ) { b.dropped++; return; }
+    b.events.push_back( { name , begin_ns , tracer().now_ns() } );
+  }
+}; // End of trace scope
+
+#if OCEAN_TRACE
+#define TRACE_CONCAT_(a,b) a##b
+#define TRACE_CONCAT(a,b) TRACE_CONCAT_(a,b)
+#define TRACE_SCOPE(name) trace_scope TRACE_CONCAT(trace_scope_,__LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ( (void)0 )
+#endif
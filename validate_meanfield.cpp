@@ -0,0 +1,149 @@
+// Compares the mean field model (meanfield.hpp) with the stochastic sweep.
+// For every point of a parameter grid it runs an ensemble of ocean
+// simulations and one mean field integration, and reports how far apart the
+// final turtle and garbage counts are, relative to the ensemble mean and in
+// standard errors of that mean.
+//
+// Usage: validate_meanfield [--sims 50] [--timesteps 50] [--seed 322] [--out meanfield.csv]
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include "ocean.hpp"
+#include "meanfield.hpp"
+
+struct validation_point {
+  int size;
+  double turtle_density , garbage_density , ship_density;
+  double turtle_rate;
+  int ship_mode; // 0 random, 1 smart, 2 smart with the distance field
+};
+
+struct validation_result {
+  validation_point p;
+  double turtle_mean , turtle_error , turtle_meanfield; // error is the standard error of the mean
+  double garbage_mean , garbage_error , garbage_meanfield;
+};
+
+double relative( double estimate , double mean ) { return std::abs(estimate-mean)/std::max(1.0,mean); }
+
+validation_result validate( const validation_point &p , int n_sims , int timesteps , int turtle_steps ,
+			    std::uint64_t seed , std::uint64_t first_sim ) {
+  int cells = p.size*p.size;
+  int turtles = std::round(p.turtle_density*cells);
+  int garbage = std::round(p.garbage_density*cells);
+  int ships = std::max(1,(int)std::round(p.ship_density*cells));
+  bool smart = p.ship_mode > 0;
+
+  // Stochastic ensemble
+  std::vector<double> end_turtles , end_garbage;
+  for ( int s=0 ; s<n_sims ; s++ ) {
+    seed_engine(simulation_seed(seed,first_sim+s)); // Replicate first_sim+s of the run, so any one can be rerun
+    ocean o(p.size,p.size,0);
+    o.initiate_grid(ships,turtles,garbage);
+    o.set_distance_navigation(p.ship_mode == 2);
+    o.simulate(timesteps,p.turtle_rate,turtle_steps,smart,false,false,1.0,0.0);
+    end_turtles.push_back(o.count_last_grid_items(cell_type::turtle));
+    end_garbage.push_back(o.count_last_grid_items(cell_type::garbage));
+  } // End loop over simulations
+  auto mean_error = [&]( const std::vector<double> &v , double &mean , double &error ) {
+    mean = 0.0;
+    for ( double x : v ) { mean += x; }
+    mean /= v.size();
+    double var = 0.0;
+    for ( double x : v ) { var += (x-mean)*(x-mean); }
+    error = v.size() > 1 ? std::sqrt(var/(v.size()-1)/v.size()) : 0.0;
+  };
+
+  // Mean field
+  meanfield_model mf;
+  mf.n_cells = cells;
+  mf.turtle_rate = p.turtle_rate;
+  mf.turtle_steps = turtle_steps;
+  mf.smart_ships = smart;
+  mf.steered_ships = p.ship_mode == 2;
+  meanfield_state end = mf.run({(double)turtles,(double)ships,(double)garbage,0.0},timesteps);
+
+  double turtle_mean , turtle_error , garbage_mean , garbage_error;
+  mean_error(end_turtles,turtle_mean,turtle_error);
+  mean_error(end_garbage,garbage_mean,garbage_error);
+  return validation_result{ .p = p ,
+			    .turtle_mean = turtle_mean , .turtle_error = turtle_error , .turtle_meanfield = end.turtles ,
+			    .garbage_mean = garbage_mean , .garbage_error = garbage_error , .garbage_meanfield = end.garbage };
+} // End validating one point
+
+int main( int argc , char **argv ) {
+  int n_sims = 50 , timesteps = 50 , turtle_steps = 5;
+  std::uint64_t seed = 322;
+  std::string out = "";
+  for ( int a=1 ; a+1<argc ; a+=2 ) {
+    std::string flag = argv[a];
+    if      ( flag == "--sims" )      { n_sims = std::max(1,std::atoi(argv[a+1])); }
+    else if ( flag == "--timesteps" ) { timesteps = std::atoi(argv[a+1]); }
+    else if ( flag == "--seed" )      { seed = std::strtoull(argv[a+1],nullptr,10); }
+    else if ( flag == "--out" )       { out = argv[a+1]; }
+    else { std::cerr << "Unknown option " << flag << '\n'; return 1; }
+  } // End reading the options
+
+  std::vector<validation_point> grid;
+  for ( int size : { 30 , 60 } ) {
+    for ( double turtle_density : { 0.02 , 0.1 } ) {
+      for ( double garbage_density : { 0.02 , 0.1 } ) {
+	for ( double turtle_rate : { 1.0 , 1.2 } ) {
+	  for ( int ship_mode : { 0 , 1 , 2 } ) {
+	    grid.push_back({size,turtle_density,garbage_density,0.01,turtle_rate,ship_mode});
+	  } // End loop over ship modes
+	} // End loop over turtle rates
+      } // End loop over garbage densities
+    } // End loop over turtle densities
+  } // End loop over sizes
+
+  const char *modes[3] = { "random" , "smart" , "steered" };
+  std::ofstream csv;
+  if ( !out.empty() ) {
+    csv.open(out);
+    if (!csv) throw std::runtime_error("Could not open "+out+" for writing.");
+    csv << "size,turtle_density,garbage_density,ship_density,turtle_rate,ship_mode,"
+	<< "turtle_mean,turtle_stderr,turtle_meanfield,garbage_mean,garbage_stderr,garbage_meanfield\n";
+  }
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "size  turtles garbage rate  ships   | turtles: ensemble  meanfield  rel    z     | garbage: ensemble  meanfield  rel    z\n";
+  double sum_rel = 0.0 , worst_rel = 0.0;
+  std::string worst;
+  for ( std::size_t k=0 ; k<grid.size() ; k++ ) {
+    const validation_point &p = grid[k];
+    validation_result r = validate(p,n_sims,timesteps,turtle_steps,seed,k*n_sims);
+    double rel_t = relative(r.turtle_meanfield,r.turtle_mean) , rel_g = relative(r.garbage_meanfield,r.garbage_mean);
+    double z_t = (r.turtle_meanfield-r.turtle_mean)/std::max(1e-9,r.turtle_error);
+    double z_g = (r.garbage_meanfield-r.garbage_mean)/std::max(1e-9,r.garbage_error);
+    std::cout << std::setw(4) << p.size << "  " << std::setw(6) << p.turtle_density << "  " << std::setw(6) << p.garbage_density
+	      << "  " << std::setw(4) << p.turtle_rate << "  " << std::setw(7) << modes[p.ship_mode]
+	      << " |          " << std::setw(8) << r.turtle_mean << "  " << std::setw(9) << r.turtle_meanfield
+	      << "  " << std::setw(5) << rel_t << "  " << std::setw(5) << z_t
+	      << " |          " << std::setw(8) << r.garbage_mean << "  " << std::setw(9) << r.garbage_meanfield
+	      << "  " << std::setw(5) << rel_g << "  " << std::setw(5) << z_g << '\n';
+    if ( csv ) {
+      csv << p.size << ',' << p.turtle_density << ',' << p.garbage_density << ',' << p.ship_density << ',' << p.turtle_rate << ','
+	  << modes[p.ship_mode] << ',' << r.turtle_mean << ',' << r.turtle_error << ',' << r.turtle_meanfield << ','
+	  << r.garbage_mean << ',' << r.garbage_error << ',' << r.garbage_meanfield << '\n';
+    }
+    sum_rel += rel_t+rel_g;
+    for ( double rel : { rel_t , rel_g } ) {
+      if ( rel > worst_rel ) {
+	worst_rel = rel;
+	worst = std::to_string(p.size) + "x" + std::to_string(p.size) + " turtles " + std::to_string(p.turtle_density)
+	  + " garbage " + std::to_string(p.garbage_density) + " rate " + std::to_string(p.turtle_rate) + " " + modes[p.ship_mode];
+      }
+    } // End tracking the worst point
+  } // End loop over the parameter grid
+  std::cout << "Mean relative error: " << sum_rel/(2*grid.size()) << '\n';
+  std::cout << "Worst relative error: " << worst_rel << " at " << worst << '\n';
+  return 0;
+} // End of main